@@ -84,6 +84,30 @@ inline unsigned SortedInsertJson(JsonPair* storage, unsigned size, JsonPair cons
     return size;
 }
 
+//! Sort pairs by key and remove duplicates (last one wins), returns new size.
+//! Already sorted input is detected in one linear pass and left as is
+inline unsigned SortUniqueJson(JsonPair* storage, unsigned size) {
+    auto end = storage + size;
+    auto unordered = std::adjacent_find(storage, end, [](const JsonPair& l, const JsonPair& r){
+        return !(l.key < r.key);
+    });
+    if (meta_Likely(unordered == end)) {
+        return size;
+    }
+    std::stable_sort(unordered, end, KeyLess{});
+    std::inplace_merge(storage, unordered, end, KeyLess{});
+    auto out = storage;
+    for (auto it = storage; it != end;) {
+        auto next = it + 1;
+        while (next != end && next->key == it->key) {
+            ++next;
+        }
+        *out++ = next[-1];
+        it = next;
+    }
+    return unsigned(out - storage);
+}
+
 JsonView Flatten(JsonView src, Arena& alloc, unsigned depth = JV_DEFAULT_DEPTH);
 
 enum CopyFlags {
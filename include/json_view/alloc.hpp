@@ -28,7 +28,6 @@ SOFTWARE.
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
-#include <forward_list>
 #include <memory>
 #include <string_view>
 #include <utility>
@@ -46,6 +45,29 @@ SOFTWARE.
 namespace jv
 {
 
+//! Memory use of one arena. Reserved bytes and blocks are current values,
+//! others are counted since creation of arena (or ResetStats())
+struct ArenaStats {
+    //! Sum of all allocation sizes
+    size_t requested = 0;
+    //! Bytes of blocks held (including spare and out-of-band ones), without stack buffer
+    size_t reserved = 0;
+    size_t blocks = 0;
+    //! Unused bytes at the end of blocks, which were left for a new block
+    size_t wasted = 0;
+    //! Allocations larger than next block: each one takes a block of its own
+    size_t outOfBand = 0;
+
+    //! Difference of counters, reserved and blocks are kept as is
+    ArenaStats Since(ArenaStats const& before) const noexcept {
+        ArenaStats result = *this;
+        result.requested -= before.requested;
+        result.wasted -= before.wasted;
+        result.outOfBand -= before.outOfBand;
+        return result;
+    }
+};
+
 struct Arena {
     static constexpr auto max_align = alignof(std::max_align_t);
     meta_alwaysInline
@@ -62,8 +84,24 @@ struct Arena {
         if (meta_Unlikely(!res)) throw std::bad_alloc{};
         return res;
     }
+    //! Grow (or shrink) the most recent allocation in place. If it is not possible
+    //! (ptr is not the last allocation or there is no space after it) false is returned
+    //! and nothing is changed
+    bool TryExtend(void* ptr, size_t oldSize, size_t newSize) noexcept {
+        return DoTryExtend(ptr, oldSize, newSize);
+    }
+    //! Arenas which do not count their memory return zeroes
+    ArenaStats Stats() const noexcept {
+        return DoStats();
+    }
 protected:
     virtual void* DoAllocate(size_t sz, size_t align) = 0;
+    virtual bool DoTryExtend(void*, size_t, size_t) noexcept {
+        return false;
+    }
+    virtual ArenaStats DoStats() const noexcept {
+        return {};
+    }
 };
 
 struct NullArena final : Arena {
@@ -72,7 +110,59 @@ struct NullArena final : Arena {
     }
 };
 
+//! Blocks of DefaultArena are recycled instead of being freed: each thread keeps a cache of them,
+//! which may be backed by shared one. Only blocks of power of two sizes from 4KB to 1MB are kept,
+//! other blocks and out-of-band allocations (larger than block size) are always freed
+struct ArenaPoolLimits {
+    //! Bytes cached by each thread
+    size_t perThread = size_t(1) << 20;
+    //! Bytes cached for all threads: blocks go there when thread cache is full
+    //! and are taken from there when it is empty. Both limits at 0 disable pooling
+    size_t shared = 0;
+};
+
+struct ArenaPoolStats {
+    //! Blocks taken from caches
+    size_t reused = 0;
+    //! Blocks allocated with operator new (or mapped)
+    size_t allocated = 0;
+    //! Blocks returned to caches
+    size_t recycled = 0;
+    //! Blocks freed, because caches were full or size was not poolable
+    size_t freed = 0;
+    size_t threadCached = 0;
+    size_t sharedCached = 0;
+};
+
+//! Blocks already cached over new limits are kept until they are used or trimmed
+void SetArenaPoolLimits(ArenaPoolLimits limits) noexcept;
+ArenaPoolLimits GetArenaPoolLimits() noexcept;
+//! Counters are of the calling thread
+ArenaPoolStats GetArenaPoolStats() noexcept;
+//! Free blocks cached by the calling thread (and shared ones as well, if requested)
+void TrimArenaPool(bool shared = false) noexcept;
+
+//! Block sizes of DefaultArena (each includes bookkeeping header). Every new block is
+//! twice as large as previous one, until maxBlock is reached. Allocations which do not fit
+//! into next block get blocks of their own
+struct ArenaGrowth {
+    size_t firstBlock = 4096;
+    //! Largest pooled size by default. Equal to firstBlock disables growth
+    size_t maxBlock = size_t(1) << 20;
+    //! Blocks (own and growing ones) of at least this size are mapped directly and aligned to 2MB, so that
+    //! they may be backed by transparent huge pages (madvise(MADV_HUGEPAGE) on Linux). 0 disables
+    size_t hugeThreshold = size_t(2) << 20;
+};
+
 namespace detail {
+constexpr size_t hugePage = size_t(2) << 20;
+constexpr size_t smallPage = 4096;
+void* takeBlock(size_t size);
+void putBlock(void* block, size_t size) noexcept;
+//! Size is a multiple of smallPage, result is aligned to hugePage
+void* mapBlock(size_t size);
+void unmapBlock(void* block, size_t size) noexcept;
+
 template<size_t sz>
 struct stackBuff {
     stackBuff() = default;
@@ -84,6 +174,26 @@ struct stackBuff<size_t(0)> {
     static constexpr char* buff = nullptr;
 };
 struct arena {
+    //! Each block starts with it, blocks are freed (or recycled) by walking this list
+    struct block {
+        block* next;
+        //! Sizes are multiples of max_align: low bits are used for flags
+        size_t size;
+    };
+    enum : size_t {
+        ownFlag = 1,
+        mappedFlag = 2,
+        flagsMask = 3,
+    };
+    static constexpr size_t header = (sizeof(block) + Arena::max_align - 1) / Arena::max_align * Arena::max_align;
+
+    static constexpr size_t roundUp(size_t size, size_t to) noexcept {
+        return (size + to - 1) / to * to;
+    }
+    static size_t bytesOf(block* b) noexcept {
+        return b->size & ~size_t(flagsMask);
+    }
+
     arena() = default;
     arena(arena const&) = delete;
     arena(arena && o) noexcept {
@@ -99,39 +209,152 @@ struct arena {
     void moveIn(arena& o) noexcept {
         buffptr = std::exchange(o.buffptr, nullptr);
         space = std::exchange(o.space, 0);
+        floor = std::exchange(o.floor, nullptr);
         blockSize = o.blockSize;
-        allocs = std::exchange(o.allocs, std::forward_list<void*>{});
+        firstBlock = o.firstBlock;
+        maxBlock = o.maxBlock;
+        hugeThreshold = o.hugeThreshold;
+        blocks = std::exchange(o.blocks, nullptr);
+        spare = std::exchange(o.spare, nullptr);
+        spareBytes = std::exchange(o.spareBytes, 0);
+        spareLimit = o.spareLimit;
+        stats = std::exchange(o.stats, ArenaStats{});
+        limit = o.limit;
     }
     ~arena() {
         clear();
     }
-    void newBlock() {
-        buffptr = allocs.emplace_front(::operator new(blockSize, std::align_val_t(Arena::max_align)));
-        space = blockSize;
+    //! Size includes header
+    void* push(size_t size, size_t flags = 0) {
+        if (meta_Unlikely(limit && stats.reserved + size > limit)) {
+            throw std::bad_alloc{};
+        }
+        auto b = static_cast<block*>(flags & mappedFlag ? mapBlock(size) : takeBlock(size));
+        stats.reserved += size;
+        stats.blocks++;
+        b->next = blocks;
+        b->size = size | flags;
+        blocks = b;
+        return reinterpret_cast<char*>(b) + header;
+    }
+    //! Oldest spare block is reused if it fits, otherwise next block is twice larger.
+    //! Blocks of at least hugeThreshold are mapped, same as own ones
+    void newBlock(size_t bytes) {
+        stats.wasted += space;
+        if (spare && spare->size - header >= bytes) {
+            auto b = std::exchange(spare, spare->next);
+            spareBytes -= b->size;
+            b->next = blocks;
+            blocks = b;
+            buffptr = reinterpret_cast<char*>(b) + header;
+            space = b->size - header;
+            return;
+        }
+        if (hugeThreshold && blockSize >= hugeThreshold) {
+            auto size = roundUp(blockSize, smallPage);
+            buffptr = push(size, mappedFlag);
+            space = size - header;
+        } else {
+            buffptr = push(blockSize);
+            space = blockSize - header;
+        }
+        blockSize = blockSize * 2 < maxBlock ? blockSize * 2 : maxBlock;
+    }
+    void* pushOwn(size_t bytes) {
+        auto size = bytes + header;
+        if (hugeThreshold && size >= hugeThreshold) {
+            return push(roundUp(size, smallPage), ownFlag | mappedFlag);
+        }
+        return push(roundUp(size, Arena::max_align), ownFlag);
+    }
+    void release(block* b) noexcept {
+        auto size = bytesOf(b);
+        stats.reserved -= size;
+        stats.blocks--;
+        if (b->size & mappedFlag) {
+            unmapBlock(b, size);
+        } else {
+            putBlock(b, size);
+        }
     }
-    void clear() {
-        for (auto a: allocs) {
-            ::operator delete(a, std::align_val_t(Arena::max_align));
+    void releaseAll(block*& list) noexcept {
+        while (list) {
+            release(std::exchange(list, list->next));
         }
-        allocs.clear();
+    }
+    void clear() noexcept {
+        releaseAll(blocks);
+        releaseAll(spare);
+        spareBytes = 0;
         buffptr = nullptr;
         space = 0;
+        floor = nullptr;
+    }
+    //! Blocks pushed after mark are kept as spare ones (up to spareLimit bytes),
+    //! out-of-band and mapped blocks are released
+    void rewind(void* mark, void* ptr, size_t left) noexcept {
+        while (blocks != mark) {
+            auto b = std::exchange(blocks, blocks->next);
+            if (!(b->size & flagsMask) && spareBytes + b->size <= spareLimit) {
+                spareBytes += b->size;
+                b->next = spare;
+                spare = b;
+            } else {
+                release(b);
+            }
+        }
+        buffptr = ptr;
+        space = left;
     }
     void* doAlloc(size_t bytes, size_t align) {
-        if (meta_Unlikely(bytes > blockSize)) {
-            return allocs.emplace_front(::operator new(bytes, std::align_val_t(Arena::max_align)));
+        stats.requested += bytes;
+        if (meta_Unlikely(bytes > blockSize - header)) {
+            stats.outOfBand++;
+            return pushOwn(bytes);
         }
         if (meta_Unlikely(!std::align(align, bytes, buffptr, space))) {
-            newBlock();
+            newBlock(bytes);
         }
         space -= bytes;
         return std::exchange(buffptr, static_cast<char*>(buffptr) + bytes);
     }
+    //! Out-of-band allocations never end at buffptr: it is past the header of its block.
+    //! Allocations made before latest mark are not touched: rewind() would hand out their bytes again
+    bool doExtend(void* ptr, size_t oldSize, size_t newSize) noexcept {
+        if (static_cast<char*>(ptr) + oldSize != buffptr) {
+            return false;
+        }
+        if (ptr < floor && floor <= buffptr) {
+            return false;
+        }
+        if (newSize > oldSize && newSize - oldSize > space) {
+            return false;
+        }
+        if (newSize > oldSize) {
+            stats.requested += newSize - oldSize;
+        }
+        space = space + oldSize - newSize;
+        buffptr = static_cast<char*>(ptr) + newSize;
+        return true;
+    }
 
     void* buffptr{};
     size_t space{};
+    //! Where latest mark was taken
+    void* floor{};
+    //! Of next new block
     size_t blockSize{};
-    std::forward_list<void*> allocs;
+    size_t firstBlock{};
+    size_t maxBlock{};
+    size_t hugeThreshold{};
+    block* blocks{};
+    //! Blocks left after rewind(), reused before new ones are taken
+    block* spare{};
+    size_t spareBytes{};
+    size_t spareLimit = size_t(1) << 20;
+    ArenaStats stats;
+    //! Of reserved bytes, 0 if none
+    size_t limit{};
 };
 } //detail
 
@@ -141,21 +364,103 @@ struct DefaultArena final : Arena,
                             protected detail::arena
 {
     DefaultArena(size_t blockSize = 4096) noexcept {
-        SetBlockSize(blockSize);
+        ArenaGrowth growth;
+        growth.firstBlock = blockSize;
+        SetGrowth(growth);
         Clear();
     }
-    void SetBlockSize(size_t sz) {
-        this->blockSize = sz;
+    //! Of first block, see ArenaGrowth
+    void SetBlockSize(size_t sz) noexcept {
+        auto growth = GetGrowth();
+        growth.firstBlock = sz;
+        SetGrowth(growth);
+    }
+    //! Blocks which are already taken are kept
+    void SetGrowth(ArenaGrowth growth) noexcept {
+        auto first = roundUp(growth.firstBlock < 2 * header ? 2 * header : growth.firstBlock, max_align);
+        auto max = roundUp(growth.maxBlock, max_align);
+        this->firstBlock = first;
+        this->maxBlock = max < first ? first : max;
+        this->hugeThreshold = growth.hugeThreshold;
+        if (this->blockSize < this->firstBlock) {
+            this->blockSize = this->firstBlock;
+        } else if (this->blockSize > this->maxBlock) {
+            this->blockSize = this->maxBlock;
+        }
+    }
+    ArenaGrowth GetGrowth() const noexcept {
+        return {this->firstBlock, this->maxBlock, this->hugeThreshold};
     }
     void Clear() {
         arena::clear();
         this->buffptr = this->buff;
         this->space = onStack;
+        this->blockSize = this->firstBlock;
+    }
+    struct Checkpoint {
+        void* block;
+        void* ptr;
+        size_t space;
+        //! Of previous mark
+        void* floor;
+    };
+    //! Allocations made before it can not be extended (see TryExtend()) until Rewind()
+    Checkpoint Mark() noexcept {
+        Checkpoint result{this->blocks, this->buffptr, this->space, this->floor};
+        this->floor = this->buffptr;
+        return result;
+    }
+    //! Drop everything allocated after mark. Its blocks are kept for next allocations
+    //! (see SetSpareLimit()). Marks taken after this one become invalid, Clear() invalidates all of them
+    void Rewind(Checkpoint const& mark) noexcept {
+        arena::rewind(mark.block, mark.ptr, mark.space);
+        this->floor = mark.floor;
+    }
+    //! Bytes of blocks kept by Rewind(), others are released (1MB by default): one big
+    //! message should not keep memory of long-living arena at its peak
+    void SetSpareLimit(size_t bytes) noexcept {
+        this->spareLimit = bytes;
+    }
+    size_t GetSpareLimit() const noexcept {
+        return this->spareLimit;
+    }
+    //! New blocks are not taken over this count of reserved bytes: std::bad_alloc is thrown
+    //! instead. Stack buffer is not counted. 0 removes limit
+    void SetLimit(size_t bytes) noexcept {
+        this->limit = bytes;
+    }
+    size_t GetLimit() const noexcept {
+        return this->limit;
+    }
+    void ResetStats() noexcept {
+        auto& st = this->stats;
+        st.requested = st.wasted = st.outOfBand = 0;
     }
 protected:
+    ArenaStats DoStats() const noexcept final {
+        return this->stats;
+    }
     void* DoAllocate(size_t bytes, size_t align) final {
         return detail::arena::doAlloc(bytes, align);
     }
+    bool DoTryExtend(void* ptr, size_t oldSize, size_t newSize) noexcept final {
+        return detail::arena::doExtend(ptr, oldSize, newSize);
+    }
+};
+
+//! Rewinds arena (see DefaultArena::Rewind()) to where it was on construction.
+//! Scopes may be nested, e.g. per message inside of per connection one
+template<typename A>
+struct ArenaScope {
+    explicit ArenaScope(A& arena) noexcept : arena(arena), mark(arena.Mark()) {}
+    ArenaScope(ArenaScope const&) = delete;
+    ArenaScope& operator=(ArenaScope const&) = delete;
+    ~ArenaScope() {
+        arena.Rewind(mark);
+    }
+private:
+    A& arena;
+    typename A::Checkpoint mark;
 };
 
 template<typename T>
@@ -169,6 +474,10 @@ struct arena_allocator {
         return static_cast<T*>(a->Allocate(sizeof(T) * n, alignof(T)));
     }
     void deallocate(T*, std::size_t) noexcept {}
+    //! See Arena::TryExtend()
+    bool extend(T* p, std::size_t n, std::size_t newN) noexcept {
+        return a->TryExtend(p, sizeof(T) * n, sizeof(T) * newN);
+    }
     template<typename U>
     bool operator==(arena_allocator<U> const& other) const noexcept {
         return a == other.a;
@@ -178,24 +487,107 @@ struct arena_allocator {
 template<typename T>
 using ArenaVector = std::vector<T, arena_allocator<T>>;
 
-struct ArenaString : public ArenaVector<char> {
-    using ArenaVector<char>::ArenaVector;
-    using ArenaVector<char>::operator=;
-
-    operator std::string_view() const noexcept {
-        return {data(), size()};
-    }
+//! Unlike ArenaVector it grows in place while it is the last allocation of Arena,
+//! so appending to it usually does not copy or waste memory
+struct ArenaString {
+    using value_type = char;
+    using size_type = size_t;
 
-    ArenaString(std::string_view part, arena_allocator<char> alloc) : ArenaVector<char>(alloc) {
+    ArenaString(arena_allocator<char> alloc) noexcept : alloc(alloc) {}
+    ArenaString(std::string_view part, arena_allocator<char> alloc) : alloc(alloc) {
         reserve(part.size() + 1);
         Append(part);
     }
+    ArenaString(ArenaString const& other) : alloc(other.alloc) {
+        Append(other);
+    }
+    ArenaString(ArenaString&& other) noexcept :
+        alloc(other.alloc),
+        ptr(std::exchange(other.ptr, nullptr)),
+        sz(std::exchange(other.sz, 0)),
+        cap(std::exchange(other.cap, 0))
+    {}
+    ArenaString& operator=(ArenaString const& other) {
+        if (this != &other) {
+            clear();
+            Append(other);
+        }
+        return *this;
+    }
+    ArenaString& operator=(ArenaString&& other) noexcept {
+        if (this != &other) {
+            alloc = other.alloc;
+            ptr = std::exchange(other.ptr, nullptr);
+            sz = std::exchange(other.sz, 0);
+            cap = std::exchange(other.cap, 0);
+        }
+        return *this;
+    }
+
+    operator std::string_view() const noexcept {
+        return {ptr, sz};
+    }
+    bool operator==(ArenaString const& other) const noexcept {
+        return std::string_view(*this) == std::string_view(other);
+    }
 
+    char* data() noexcept { return ptr; }
+    const char* data() const noexcept { return ptr; }
+    size_t size() const noexcept { return sz; }
+    size_t capacity() const noexcept { return cap; }
+    bool empty() const noexcept { return !sz; }
+    char* begin() noexcept { return ptr; }
+    char* end() noexcept { return ptr + sz; }
+    const char* begin() const noexcept { return ptr; }
+    const char* end() const noexcept { return ptr + sz; }
+    char& operator[](size_t idx) noexcept { return ptr[idx]; }
+    char operator[](size_t idx) const noexcept { return ptr[idx]; }
+
+    void clear() noexcept {
+        sz = 0;
+    }
+    void reserve(size_t n) {
+        if (n <= cap) {
+            return;
+        }
+        if (ptr && alloc.extend(ptr, cap, n)) {
+            cap = n;
+            return;
+        }
+        auto fresh = alloc.allocate(n);
+        if (sz) ::memcpy(fresh, ptr, sz);
+        ptr = fresh;
+        cap = n;
+    }
+    void resize(size_t n) {
+        if (n > sz) {
+            grow(n);
+            ::memset(ptr + sz, 0, n - sz);
+        }
+        sz = n;
+    }
+    void push_back(char ch) {
+        grow(sz + 1);
+        ptr[sz++] = ch;
+    }
     void Append(std::string_view part) {
-        auto was = size();
-        resize(was + part.size());
-        ::memcpy(data() + was, part.data(), part.size());
+        if (part.empty()) {
+            return;
+        }
+        grow(sz + part.size());
+        ::memcpy(ptr + sz, part.data(), part.size());
+        sz += part.size();
+    }
+private:
+    void grow(size_t n) {
+        if (n > cap) {
+            reserve(n < cap * 2 ? cap * 2 : n);
+        }
     }
+    arena_allocator<char> alloc;
+    char* ptr = nullptr;
+    size_t sz = 0;
+    size_t cap = 0;
 };
 
 } //jv
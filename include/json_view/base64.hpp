@@ -0,0 +1,71 @@
+// This file is a part of RPCXX project
+
+/*
+Copyright 2024 "NEOLANT Service", "NEOLANT Kalinigrad", Alexey Doronin, Anastasia Lugovets, Dmitriy Dyakonov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef JV_BASE64_HPP
+#define JV_BASE64_HPP
+#pragma once
+
+#include "json_view.hpp"
+#include <vector>
+
+namespace jv
+{
+
+//! Length of base64 text for size bytes (padded)
+constexpr size_t Base64Size(size_t size) noexcept {
+    return (size + 2) / 3 * 4;
+}
+//! Standard alphabet with padding (RFC 4648). Out must have Base64Size(data.size()) bytes.
+//! Returns end of written text
+char* EncodeBase64(char* out, string_view data) noexcept;
+//! Upper bound of decoded size, exact for valid text
+size_t Base64DecodedSize(string_view text) noexcept;
+//! Padding is optional, whitespace and url-safe alphabet are not accepted.
+//! Out must have Base64DecodedSize(text) bytes. Returns end of written data or nullptr if text is invalid
+char* DecodeBase64(char* out, string_view text) noexcept;
+
+//! Json has no binary type: t_binary is dumped as base64 string. This reverses that:
+//! t_string is decoded into alloc, t_binary is returned as is, other types throw
+JsonView DecodeBinary(JsonView json, Arena& alloc, TraceFrame const& frame = {});
+
+//! Opt-in binary field: goes into msgpack as bin and into json as base64 string.
+//! Accepts both when read (plain std::vector<char> is still an array of numbers)
+struct Bytes : std::vector<char> {
+    using std::vector<char>::vector;
+    string_view View() const noexcept {
+        return {data(), size()};
+    }
+};
+
+template<>
+struct Convert<Bytes> {
+    static JsonView DoIntoJson(Bytes const& value, Arena&) {
+        return JsonView::Binary(value.View());
+    }
+    static void DoFromJson(Bytes& value, JsonView json, TraceFrame const& frame);
+};
+
+}
+
+#endif //JV_BASE64_HPP
@@ -45,6 +45,8 @@ enum Type : int16_t {
     t_object    = 1 << 7,
     t_discarded = 1 << 8,
     t_custom    = 1 << 9,
+    //! not yet parsed fragment of input (see ParseSettings::rawKeys)
+    t_raw       = 1 << 10,
 
     t_float     = t_number,
     t_any_integer = t_signed | t_unsigned,
@@ -52,13 +54,21 @@ enum Type : int16_t {
 };
 
 // can be used to indicate some invariant about JsonView layout
-// unused for now
 enum Flags : short {
     f_none      = 0,
+    //t_raw fragment is MsgPack (JSON otherwise)
+    f_raw_msgpack = 1 << 0,
+    //number is kept as json text (see ParseSettings::lazyNumbers)
+    f_lazy_number = 1 << 1,
     //flags below will not be used by library
     f_user      = 1 << sizeof(short) * 4,
 };
 
+enum class RawFormat : uint8_t {
+    json,
+    msgpack,
+};
+
 constexpr Type operator|(Type l, Type r) noexcept {
     return Type(int(l) | int(r));
 }
@@ -29,6 +29,8 @@ SOFTWARE.
 
 #include "membuff/membuff.hpp"
 #include "json_view.hpp"
+#include "base64.hpp"
+#include <tuple>
 
 namespace jv
 {
@@ -41,6 +43,12 @@ struct DumpOptions {
 };
 
 void DumpJsonInto(membuff::Out& out, JsonView json, DumpOptions opts = {});
+//! Upper bound of DumpJsonInto() output size: exact, except that each double is counted as 25 bytes.
+//! T_raw values which need reformatting are parsed for that (and once more when dumped)
+size_t JsonSizeBound(JsonView json, DumpOptions opts = {});
+//! Buffer must have at least JsonSizeBound(json, opts) bytes, it is written without any checks.
+//! Returns end of written data
+char* DumpJsonTo(char* buffer, JsonView json, DumpOptions opts = {});
 
 inline std::string DumpJson(JsonView j, DumpOptions opts = {}) {
     membuff::StringOut buff;
@@ -49,6 +57,11 @@ inline std::string DumpJson(JsonView j, DumpOptions opts = {}) {
 }
 
 void DumpMsgPackInto(membuff::Out& out, JsonView json, DumpOptions opts = {});
+//! Exact size of DumpMsgPackInto() output, e.g. for length-prefixed frames
+size_t MsgPackSize(JsonView json, DumpOptions opts = {});
+//! Buffer must have at least MsgPackSize(json, opts) bytes, it is written without any checks.
+//! Returns end of written data
+char* DumpMsgPackTo(char* buffer, JsonView json, DumpOptions opts = {});
 
 inline std::string DumpMsgPack(JsonView j, DumpOptions opts = {}) {
     membuff::StringOut buff;
@@ -56,6 +69,221 @@ inline std::string DumpMsgPack(JsonView j, DumpOptions opts = {}) {
     return buff.Consume();
 }
 
+namespace detail {
+
+//! Used by Serialize*(): values are written one by one, sizes of containers must be known in advance.
+//! Item()/Key() go before each element, idx starts from 0
+class MsgPackEncoder {
+public:
+    explicit MsgPackEncoder(membuff::Out& out) noexcept : out(out) {}
+    void Null();
+    void Bool(bool v);
+    void Int(int64_t v);
+    void UInt(uint64_t v);
+    void Double(double v);
+    void String(string_view v);
+    void Binary(string_view v);
+    //! Strings of temporary json (e.g. in arena which dies before output) are always copied,
+    //! others may be referenced (see membuff::Out::WriteRef())
+    void Value(JsonView json, unsigned depth, bool temporary = false);
+    //! Items of array, without Item() calls
+    void Doubles(const double* data, unsigned size);
+    void StartArray(unsigned size);
+    void Item(unsigned) noexcept {}
+    void EndArray() noexcept {}
+    void StartObject(unsigned size);
+    void Key(unsigned, string_view key) { String(key); }
+    void EndObject() noexcept {}
+private:
+    membuff::Out& out;
+};
+
+class JsonEncoder {
+public:
+    explicit JsonEncoder(membuff::Out& out) noexcept : out(out) {}
+    void Null();
+    void Bool(bool v);
+    void Int(int64_t v);
+    void UInt(uint64_t v);
+    void Double(double v);
+    void String(string_view v);
+    //! Base64 string
+    void Binary(string_view v);
+    //! Json output is always copied
+    void Value(JsonView json, unsigned depth, bool temporary = false);
+    void Doubles(const double* data, unsigned size);
+    void StartArray(unsigned size);
+    void Item(unsigned idx);
+    void EndArray();
+    void StartObject(unsigned size);
+    void Key(unsigned idx, string_view key);
+    void EndObject();
+private:
+    membuff::Out& out;
+};
+
+template<typename T> struct isTuple : std::false_type {};
+template<typename...Ts> struct isTuple<std::tuple<Ts...>> : std::true_type {};
+template<typename A, typename B> struct isTuple<std::pair<A, B>> : std::true_type {};
+
+template<typename Enc, typename T>
+void serialize(Enc& enc, T const& value, unsigned depth);
+
+template<typename T>
+constexpr bool hasManualIdx() {
+    bool result = false;
+    describe::Get<T>::for_each([&](auto f){
+        if constexpr (f.is_field) {
+            result = result || getIdxFor<decltype(f)>() != 0;
+        }
+    });
+    return result;
+}
+
+//! Same slots as in serializeAsTuple(), missing ones are null
+template<typename Enc, typename T>
+void serializeAsTuple(Enc& enc, T const& value, unsigned depth) {
+    constexpr auto desc = describe::Get<T>();
+    constexpr auto total = maxIdxFor<T>();
+    enc.StartArray(total);
+    if constexpr (!hasManualIdx<T>()) {
+        unsigned count = 0;
+        desc.for_each([&](auto f){
+            if constexpr (f.is_field) {
+                enc.Item(count++);
+                serialize(enc, f.get(value), depth - 1);
+            }
+        });
+    } else {
+        for (unsigned slot = 0; slot < total; ++slot) {
+            enc.Item(slot);
+            bool found = false;
+            unsigned count = 0;
+            desc.for_each([&](auto f){
+                if constexpr (f.is_field) {
+                    constexpr auto manual = getIdxFor<decltype(f)>();
+                    if (!found && (manual ? manual : count) == slot) {
+                        serialize(enc, f.get(value), depth - 1);
+                        found = true;
+                    }
+                    count++;
+                }
+            });
+            if (!found) {
+                enc.Null();
+            }
+        }
+    }
+    enc.EndArray();
+}
+
+template<typename Enc, typename T>
+void serialize(Enc& enc, T const& value, unsigned depth) {
+    DepthError::Check(depth);
+    if constexpr (std::is_same_v<T, bool>) {
+        enc.Bool(value);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        enc.Int(int64_t(value));
+    } else if constexpr (std::is_integral_v<T>) {
+        enc.UInt(uint64_t(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        enc.Double(double(value));
+    } else if constexpr (std::is_same_v<T, JsonView>) {
+        enc.Value(value, depth);
+    } else if constexpr (std::is_same_v<T, Json>) {
+        enc.Value(value.View(), depth);
+    } else if constexpr (std::is_convertible_v<T, string_view>) {
+        enc.String(string_view{value});
+    } else if constexpr (std::is_same_v<T, Bytes>) {
+        enc.Binary(value.View());
+    } else if constexpr (is_optional<T>::value) {
+        if (value) {
+            serialize(enc, *value, depth);
+        } else {
+            enc.Null();
+        }
+    } else if constexpr (hasOwnConvert<T>::value) {
+        DefaultArena alloc;
+        enc.Value(JsonView::From(value, alloc), depth, true);
+    } else if constexpr (describe::is_described_enum_v<T>) {
+        NullArena noalloc;
+        enc.Value(Convert<T>::DoIntoJson(value, noalloc), depth);
+    } else if constexpr (describe::is_described_struct_v<T>) {
+        if constexpr (describe::has_v<StructAsTuple, T>) {
+            serializeAsTuple(enc, value, depth);
+        } else {
+            enc.StartObject(describe::fields_count<T>());
+            unsigned idx = 0;
+            describe::Get<T>().for_each([&](auto f){
+                if constexpr (f.is_field) {
+                    enc.Key(idx++, f.name);
+                    serialize(enc, f.get(value), depth - 1);
+                }
+            });
+            enc.EndObject();
+        }
+    } else if constexpr (is_assoc_container_v<T>) {
+        enc.StartObject(unsigned(value.size()));
+        unsigned idx = 0;
+        for (auto& [k, v]: value) {
+            enc.Key(idx++, string_view{k});
+            serialize(enc, v, depth - 1);
+        }
+        enc.EndObject();
+    } else if constexpr (is_index_container_v<T>) {
+        using V = typename T::value_type;
+        enc.StartArray(unsigned(value.size()));
+        if constexpr (std::is_same_v<V, double> && detail::is_resizable_contiguous<T>::value) {
+            if (!value.empty()) {
+                DepthError::Check(depth - 1);
+            }
+            enc.Doubles(value.data(), unsigned(value.size()));
+        } else {
+            unsigned idx = 0;
+            for (auto&& v: value) {
+                enc.Item(idx++);
+                serialize<Enc, V>(enc, v, depth - 1);
+            }
+        }
+        enc.EndArray();
+    } else if constexpr (isTuple<T>::value) {
+        enc.StartArray(unsigned(std::tuple_size_v<T>));
+        unsigned idx = 0;
+        std::apply([&](auto const&...items){
+            ((enc.Item(idx++), serialize(enc, items, depth - 1)), ...);
+        }, value);
+        enc.EndArray();
+    } else {
+        DefaultArena alloc;
+        enc.Value(JsonView::From(value, alloc), depth, true);
+    }
+}
+
+} //detail
+
+//! Value is written straight into out, without building JsonView::From() first.
+//! Result is same as of DumpMsgPackInto(out, JsonView::From(value, alloc)), but fields
+//! of described structs are written in declaration order (not sorted by keys).
+//! Described structs and enums, optionals, containers, pairs and tuples are walked here,
+//! other types (and those of them which have own Convert<> specialization) go through JsonView::From()
+template<typename T>
+void SerializeMsgPack(membuff::Out& out, T const& value, DumpOptions opts = {}) {
+    detail::MsgPackEncoder enc{out};
+    detail::serialize(enc, value, opts.maxDepth);
+}
+
+//! Same as SerializeMsgPack(), but for json. Pretty output is made with DumpJsonInto()
+template<typename T>
+void SerializeJson(membuff::Out& out, T const& value, DumpOptions opts = {}) {
+    if (opts.pretty) {
+        DefaultArena alloc;
+        DumpJsonInto(out, JsonView::From(value, alloc), opts);
+    } else {
+        detail::JsonEncoder enc{out};
+        detail::serialize(enc, value, opts.maxDepth);
+    }
+}
+
 template<typename T>
 JsonView DumpStruct(Arena& alloc) {
     if constexpr (describe::is_described_enum_v<T>) {
@@ -503,6 +503,11 @@ JsonView BasicMutJson<Config>::View(Arena& alloc, unsigned depth) const {
 
 template<typename Config>
 void BasicMutJson<Config>::copy(BasicMutJson &to, JsonView src, unsigned int depth) {
+    if (meta_Unlikely(src.Is(t_raw))) {
+        DefaultArena alloc;
+        return copy(to, Materialize(src, alloc), depth);
+    }
+    src = src.ParsedNumber();
     DepthError::Check(depth--);
     to = {src.GetType()};
     switch (src.GetType()) {
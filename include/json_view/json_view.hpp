@@ -36,6 +36,7 @@ SOFTWARE.
 #include <string.h>
 #include <stdexcept>
 #include <optional>
+#include <array>
 
 namespace jv
 {
@@ -179,6 +180,26 @@ struct JsonView
         res.type = t_binary;
         return res;
     }
+    //! Value which is already encoded (e.g. cached response). It is not validated here.
+    //! Dumps copy it verbatim when format matches (pretty json is reformatted), otherwise it is transcoded
+    static JsonView Raw(string_view data, RawFormat format = RawFormat::json) noexcept {
+        Data res;
+        res.size = unsigned(data.size());
+        res.d.string = data.data();
+        res.type = t_raw;
+        res.flags = format == RawFormat::msgpack ? f_raw_msgpack : f_none;
+        return res;
+    }
+    //! Number which is converted only when read. Text must be a valid json number,
+    //! type: t_signed/t_unsigned for integers (by sign), t_number otherwise
+    static JsonView LazyNumber(string_view text, Type type) noexcept {
+        Data res;
+        res.size = unsigned(text.size());
+        res.d.string = text.data();
+        res.type = type;
+        res.flags = f_lazy_number;
+        return res;
+    }
     static JsonView Discarded(string_view why = {}) noexcept {
         JsonView res = {why};
         res.data.type = t_discarded;
@@ -217,6 +238,21 @@ struct JsonView
         AssertType(t_binary, frame);
         return GetBinaryUnsafe();
     }
+    string_view GetRaw(TraceFrame const& frame = {}) const {
+        AssertType(t_raw, frame);
+        return {data.d.string, data.size};
+    }
+    RawFormat GetRawFormat() const noexcept {
+        return data.flags & f_raw_msgpack ? RawFormat::msgpack : RawFormat::json;
+    }
+    //! Original text of lazy number (empty for any other value)
+    string_view GetNumberText() const noexcept {
+        return data.flags & f_lazy_number ? string_view{data.d.string, data.size} : string_view{};
+    }
+    //! Lazy number converted into regular one. Other values are returned as is
+    JsonView ParsedNumber() const {
+        return meta_Likely(!(data.flags & f_lazy_number)) ? *this : parseNumber();
+    }
     string_view GetStringUnsafe() const {
         return string_view{data.d.string, data.size};
     }
@@ -289,6 +325,7 @@ struct JsonView
         return data;
     }
 protected:
+    JsonView parseNumber() const;
     Data data;
 };
 
@@ -467,6 +504,7 @@ inline string_view JsonView::PrintType(Type t) noexcept {
     case t_discarded: return std::string_view("discarded");
     case t_number: return std::string_view("number");
     case t_custom: return std::string_view("custom");
+    case t_raw: return std::string_view("raw");
     default: return std::string_view("<invalid>");
     }
 }
@@ -560,12 +598,59 @@ template<typename T> void deserializeFromTuple(T& obj, JsonView json, TraceFrame
 template<typename T> JsonView serializeAsTuple(T const& value, Arena& alloc);
 template<typename Validator, typename T> void runValidator(T& output, TraceFrame const& next);
 
+template<size_t count>
+struct SortedFields {
+    //! Position of each field (in declaration order) in object sorted by keys
+    std::array<unsigned, count> slots{};
+    //! Reverse of slots: fields in order of their keys
+    std::array<unsigned, count> order{};
+    std::array<string_view, count> names{};
+    bool unique = true;
+};
+
+//! Bottom-up merge sort: std::sort is not constexpr, and structs may have hundreds of fields
+template<typename T>
+constexpr auto sortFields() {
+    constexpr auto names = describe::field_names<T>();
+    constexpr size_t count = names.size();
+    SortedFields<count> result;
+    auto& order = result.order;
+    std::array<unsigned, count> temp{};
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = unsigned(i);
+    }
+    for (size_t width = 1; width < count; width *= 2) {
+        for (size_t lo = 0; lo < count; lo += 2 * width) {
+            size_t mid = (std::min)(lo + width, count);
+            size_t hi = (std::min)(lo + 2 * width, count);
+            size_t l = lo, r = mid, out = lo;
+            while (l < mid && r < hi) {
+                temp[out++] = names[order[r]] < names[order[l]] ? order[r++] : order[l++];
+            }
+            while (l < mid) temp[out++] = order[l++];
+            while (r < hi) temp[out++] = order[r++];
+        }
+        order = temp;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        result.slots[order[i]] = unsigned(i);
+        result.names[i] = names[order[i]];
+        if (i && result.names[i] == result.names[i - 1]) {
+            result.unique = false;
+        }
+    }
+    return result;
+}
+
 } //detail
 
 /// Conversions
 template<typename T, typename>
 struct Convert
 {
+    //! Marks conversions which Serialize*() replicate. Types with other Convert<> go through it
+    using generic_tag = void;
+
     static JsonView DoIntoJson(T const& value, Arena& ctx) {
         constexpr bool trivial = std::is_arithmetic_v<T>
                                  || std::is_same_v<T, JsonView>
@@ -581,18 +666,30 @@ struct Convert
                 constexpr auto desc = describe::Get<T>();
                 constexpr auto size = describe::fields_count<T>();
                 auto obj = MakeObjectOf(size, ctx);
-                unsigned count = 0;
-                desc.for_each([&](auto f) {
-                    if constexpr (f.is_field) {
-                        auto entry = JsonPair{f.name, JsonView::From(f.get(value), ctx)};
-                        count = SortedInsertJson(obj, count, entry, size);
-                    }
-                });
-                Data result;
-                result.type = t_object;
-                result.size = count;
-                result.d.object = obj;
-                return JsonView(result);
+                static constexpr auto sorted = detail::sortFields<T>();
+                if constexpr (sorted.unique) {
+                    // order of keys is known at compile time: each field goes to its slot
+                    unsigned idx = 0;
+                    desc.for_each([&](auto f) {
+                        if constexpr (f.is_field) {
+                            obj[sorted.slots[idx++]] = JsonPair{f.name, JsonView::From(f.get(value), ctx)};
+                        }
+                    });
+                    return JsonView(obj, size, JsonView::sorted_tag{});
+                } else {
+                    unsigned count = 0;
+                    desc.for_each([&](auto f) {
+                        if constexpr (f.is_field) {
+                            auto entry = JsonPair{f.name, JsonView::From(f.get(value), ctx)};
+                            count = SortedInsertJson(obj, count, entry, size);
+                        }
+                    });
+                    Data result;
+                    result.type = t_object;
+                    result.size = count;
+                    result.d.object = obj;
+                    return JsonView(result);
+                }
             }
         } else if constexpr(describe::is_described_enum_v<T>) {
             if constexpr (describe::has_v<EnumAsInteger, T>) {
@@ -622,6 +719,7 @@ struct Convert
             json.AssertType(t_boolean, frame);
             value = json.GetUnsafe().d.boolean;
         } else if constexpr (std::is_arithmetic_v<T>) {
+            json = json.ParsedNumber();
             if constexpr (std::is_floating_point_v<T>) {
                 switch(json.GetType()) {
                 case t_signed: {
@@ -723,6 +821,8 @@ void impl_from(const JsonView* source, Tuple& out, TraceFrame const& frame, std:
 template<typename...Ts>
 struct Convert<std::tuple<Ts...>>
 {
+    using generic_tag = void;
+
     static JsonView DoIntoJson(std::tuple<Ts...> const& value, Arena& ctx) {
         constexpr unsigned count = sizeof...(Ts);
         auto arr = static_cast<JsonView*>(ctx(sizeof(JsonView) * count));
@@ -742,6 +842,8 @@ struct Convert<std::tuple<Ts...>>
 template<typename T>
 struct Convert<std::optional<T>>
 {
+    using generic_tag = void;
+
     static JsonView DoIntoJson(std::optional<T> const& value, Arena& ctx) {
         return value ? JsonView::From(*value, ctx) : JsonView(nullptr);
     }
@@ -764,13 +866,67 @@ JsonView IntoJson(T const& value, Arena& ctx) {
     return JsonView(arr, count);
 }
 
+namespace detail {
+
+//! User specialized Convert<T>: generic paths (Serialize*(), ReadAs()) must go through it
+template<typename T, typename = void>
+struct hasOwnConvert : std::true_type {};
+template<typename T>
+struct hasOwnConvert<T, std::void_t<typename Convert<T>::generic_tag>> : std::false_type {};
+
+template<typename T, typename = void>
+struct is_resizable_contiguous : std::false_type {};
+template<typename T>
+struct is_resizable_contiguous<T, std::void_t<
+    decltype(std::declval<T&>().data()),
+    decltype(std::declval<T&>().resize(size_t{}))>> : std::true_type {};
+
+//! Items of the same number type as output are converted without full dispatch,
+//! anything else (lazy numbers, other types, errors) goes through usual GetTo()
+template<typename V>
+void numbersFromJson(V* out, const JsonView* items, unsigned size, TraceFrame const& frame) {
+    for (unsigned i = 0; i < size; ++i) {
+        auto& data = items[i].GetUnsafe();
+        if constexpr (std::is_floating_point_v<V>) {
+            if (meta_Likely(data.type == t_number && !data.flags)) {
+                out[i] = static_cast<V>(data.d.number);
+                continue;
+            }
+        } else if constexpr (std::is_signed_v<V>) {
+            if (meta_Likely(data.type == t_signed && !data.flags
+                            && data.d.integer >= (std::numeric_limits<V>::min)()
+                            && data.d.integer <= (std::numeric_limits<V>::max)())) {
+                out[i] = static_cast<V>(data.d.integer);
+                continue;
+            }
+        } else {
+            if (meta_Likely(data.type == t_unsigned && !data.flags
+                            && data.d.uinteger <= (std::numeric_limits<V>::max)())) {
+                out[i] = static_cast<V>(data.d.uinteger);
+                continue;
+            }
+        }
+        items[i].GetTo(out[i], TraceFrame(i, frame));
+    }
+}
+
+} //detail
+
 template<typename T, if_vector_like<T> = 1>
 void FromJson(T& out, JsonView json, TraceFrame const& frame) {
     json.AssertType(t_array, frame);
-    out.clear();
-    unsigned count = 0;
-    for (JsonView i: json.Array(false)) {
-        i.GetTo(out.emplace_back(), TraceFrame(count++, frame));
+    using V = typename T::value_type;
+    constexpr bool numbers = std::is_arithmetic_v<V> && !std::is_same_v<V, bool>;
+    if constexpr (numbers && detail::is_resizable_contiguous<T>::value) {
+        auto& data = json.GetUnsafe();
+        out.resize(data.size);
+        detail::numbersFromJson(out.data(), data.d.array, data.size, frame);
+    } else {
+        out.clear();
+        unsigned count = 0;
+        for (JsonView i: json.Array(false)) {
+            i.GetTo(out.emplace_back(), TraceFrame(count++, frame));
+        }
     }
 }
 
@@ -1011,25 +1167,76 @@ JsonView serializeAsTuple(const T &value, Arena &alloc)
 }
 
 
+//! Keys of object and names of fields are both sorted: values of fields are found by one merge
+//! of the two lists (unknown keys are skipped), but binary search is used if object is much wider
+template<size_t count>
+void findFields(SortedFields<count> const& sorted, JsonView json, const JsonView** found) noexcept {
+    auto pair = json.GetUnsafe().d.object;
+    auto size = json.GetUnsafe().size;
+    if (size > count * 8) {
+        for (unsigned i = 0; i < count; ++i) {
+            auto res = sortedFind(pair, size, sorted.names[i]);
+            found[sorted.order[i]] = res ? &res->value : nullptr;
+        }
+        return;
+    }
+    auto end = pair + size;
+    unsigned i = 0;
+    while (i < count && pair != end) {
+        auto cmp = pair->key.compare(sorted.names[i]);
+        if (cmp < 0) {
+            ++pair;
+        } else if (cmp > 0) {
+            found[sorted.order[i++]] = nullptr;
+        } else {
+            found[sorted.order[i++]] = &(pair++)->value;
+        }
+    }
+    while (i < count) {
+        found[sorted.order[i++]] = nullptr;
+    }
+}
+
 template<typename T>
 void deserializeFields(T& obj, JsonView json, TraceFrame const& frame) {
     constexpr auto desc = describe::Get<T>();
-    desc.for_each([&](auto field){
-        if constexpr (field.is_field) {
-            using F = decltype(field);
-            auto& output = field.get(obj);
-            auto next = TraceFrame(field.name, frame);
-            if constexpr (isRequired<F>()) {
-                json.At(field.name, frame).GetTo(output, next);
-            } else {
-                if (auto f = json.FindVal(field.name, frame)) {
-                    f->GetTo(output, next);
+    static constexpr auto sorted = sortFields<T>();
+    if constexpr (sorted.unique) {
+        const JsonView* found[sorted.slots.size() ? sorted.slots.size() : 1];
+        findFields(sorted, json, found);
+        unsigned idx = 0;
+        desc.for_each([&](auto field){
+            if constexpr (field.is_field) {
+                using F = decltype(field);
+                auto& output = field.get(obj);
+                auto next = TraceFrame(field.name, frame);
+                if (auto src = found[idx++]) {
+                    src->GetTo(output, next);
+                } else if constexpr (isRequired<F>()) {
+                    json.throwKeyError(field.name, frame);
                 }
+                using validator = describe::extract_t<Validator, F>;
+                runValidator<validator>(output, next);
             }
-            using validator = describe::extract_t<Validator, F>;
-            runValidator<validator>(output, next);
-        }
-    });
+        });
+    } else {
+        desc.for_each([&](auto field){
+            if constexpr (field.is_field) {
+                using F = decltype(field);
+                auto& output = field.get(obj);
+                auto next = TraceFrame(field.name, frame);
+                if constexpr (isRequired<F>()) {
+                    json.At(field.name, frame).GetTo(output, next);
+                } else {
+                    if (auto f = json.FindVal(field.name, frame)) {
+                        f->GetTo(output, next);
+                    }
+                }
+                using validator = describe::extract_t<Validator, F>;
+                runValidator<validator>(output, next);
+            }
+        });
+    }
 }
 
 template<typename To, typename FromT>
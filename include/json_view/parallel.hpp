@@ -0,0 +1,62 @@
+// This file is a part of RPCXX project
+
+/*
+Copyright 2024 "NEOLANT Service", "NEOLANT Kalinigrad", Alexey Doronin, Anastasia Lugovets, Dmitriy Dyakonov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef JV_PARALLEL_HPP
+#define JV_PARALLEL_HPP
+#pragma once
+
+#include "parse.hpp"
+#include <memory>
+
+namespace jv
+{
+
+//! Parses big top-level arrays (batches) on several threads: boundaries of elements are found
+//! with cheap structural scan first, then elements are parsed by workers, each into its own Arena.
+//! Other inputs (and ones smaller than MinSize()) are parsed on calling thread.
+//! Strings reference input (as with ParseJsonInPlace(string_view) and ParseMsgPackInPlace()),
+//! so it must outlive result. Result is owned by parser and is valid until next Parse*() call.
+//! Errors are same as of single-threaded parse. One parse at a time
+class ParallelParser {
+public:
+    //! 0 => std::thread::hardware_concurrency(). Calling thread takes part in parsing
+    explicit ParallelParser(unsigned threads = 0);
+    ParallelParser(ParallelParser const&) = delete;
+    ParallelParser& operator=(ParallelParser const&) = delete;
+    ~ParallelParser();
+
+    unsigned Threads() const noexcept;
+    size_t MinSize() const noexcept;
+    void SetMinSize(size_t bytes) noexcept;
+
+    JsonView ParseJson(string_view json, ParseSettings params = {});
+    ParseResult ParseMsgPack(string_view data, ParseSettings params = {});
+private:
+    struct Impl;
+    std::unique_ptr<Impl> d;
+};
+
+}
+
+#endif //JV_PARALLEL_HPP
@@ -39,9 +39,35 @@ struct ParsingError : public std::runtime_error {
     size_t position = 0;
 };
 
+enum class JsonBackend {
+    //! rapidjson-based reader, handles everything
+    generic,
+    //! two-stage SIMD reader: structural index first, then DOM is built from it.
+    //! Falls back to generic for inputs with comments
+    simd,
+};
+
 struct ParseSettings {
     ParseSettings() = default;
     unsigned maxDepth = JV_DEFAULT_DEPTH;
+    JsonBackend backend = JsonBackend::generic;
+    //! Values of these keys in top-level object (or in objects of top-level array)
+    //! are not parsed, but kept as t_raw slices of input instead. See Materialize().
+    //! Json: honored by simd backend (forced when set), if input has comments everything is parsed.
+    //! Only brackets of skipped json values are checked, full validation happens in Materialize()
+    const string_view* rawKeys = nullptr;
+    unsigned rawKeysCount = 0;
+    //! Json: keep numbers as slices of input (see JsonView::LazyNumber()), which are converted on read.
+    //! Only numbers that cannot overflow are kept (up to 18 digits for integers), others are parsed.
+    //! Ignored by JsonStreamParser (its input chunks are not kept)
+    bool lazyNumbers = false;
+
+    bool IsRawKey(string_view key) const noexcept {
+        for (unsigned i = 0; i < rawKeysCount; ++i) {
+            if (rawKeys[i] == key) return true;
+        }
+        return false;
+    }
 };
 
 struct [[nodiscard]] ParseResult {
@@ -52,10 +78,42 @@ struct [[nodiscard]] ParseResult {
     }
 };
 
+//! Incremental json parser: input may be fed in chunks as they arrive.
+//! Partial DOM and all other state is kept in Arena, strings are copied there.
+//! Accepts same grammar as generic backend (comments, trailing commas, NaN/Infinity).
+//! ParseSettings::rawKeys are ignored: everything is parsed
+class JsonStreamParser {
+public:
+    struct [[nodiscard]] Status {
+        //! Less than chunk size only if document was completed inside of it
+        size_t consumed;
+        bool done;
+    };
+    explicit JsonStreamParser(Arena& alloc, ParseSettings params = {});
+    JsonStreamParser(JsonStreamParser&& other) noexcept;
+    JsonStreamParser& operator=(JsonStreamParser&& other) noexcept;
+    ~JsonStreamParser();
+
+    //! After document is done only whitespace and comments are accepted
+    Status Feed(string_view chunk);
+    //! Input has ended. Completes top-level scalars (like '123') or throws if document is incomplete
+    JsonView Finish();
+    bool Done() const noexcept;
+    JsonView Result() const noexcept;
+private:
+    struct Impl;
+    Impl* d;
+};
 
+//! Streamed through JsonStreamParser. With rawKeys, lazyNumbers or simd backend
+//! whole input is read into Arena first and parsed as a buffer
 JsonView ParseJson(std::istream& data, Arena& alloc, ParseSettings params = {});
 JsonView ParseJson(membuff::In& data, Arena& alloc, ParseSettings params = {});
 JsonView ParseJsonInPlace(char* buff, size_t len, Arena& alloc, ParseSettings params = {});
+//! Json is not modified and must outlive result: strings without escapes, t_raw values and lazy numbers
+//! reference it, only escaped strings are decoded into alloc. Simd backend is always used,
+//! inputs which it cannot handle (with comments) are copied and parsed same as in ParseJson()
+JsonView ParseJsonInPlace(string_view json, Arena& alloc, ParseSettings params = {});
 JsonView ParseJsonFile(std::filesystem::path const& file, Arena& alloc, ParseSettings params = {});
 JsonView ParseJson(string_view json, Arena& alloc, ParseSettings params = {});
 
@@ -64,6 +122,39 @@ ParseResult ParseMsgPackInPlace(string_view data, Arena& alloc, ParseSettings pa
 ParseResult ParseMsgPackInPlace(const void* data, size_t size, Arena& alloc, ParseSettings params = {});
 ParseResult ParseMsgPack(membuff::In& reader, Arena& alloc, ParseSettings params = {});
 
+//! Incremental msgpack decoder for streams without framing: finds where each message ends.
+//! Feed() stops right after a complete message, so several messages may be taken from one chunk.
+//! Bytes of each message are copied into Arena (chunks do not have to outlive parser) and
+//! then parsed in place. After ParsingError the stream cannot be resumed
+class MsgPackStreamParser {
+public:
+    struct [[nodiscard]] Status {
+        //! Less than chunk size only if message was completed inside of it
+        size_t consumed;
+        bool done;
+    };
+    explicit MsgPackStreamParser(Arena& alloc, ParseSettings params = {});
+    MsgPackStreamParser(MsgPackStreamParser&& other) noexcept;
+    MsgPackStreamParser& operator=(MsgPackStreamParser&& other) noexcept;
+    ~MsgPackStreamParser();
+
+    //! Once message is done, next call starts the next one
+    Status Feed(string_view chunk);
+    //! Input has ended. Returns last message or throws if it is incomplete
+    JsonView Finish();
+    bool Done() const noexcept;
+    //! Some bytes of next message were already consumed
+    bool Pending() const noexcept;
+    JsonView Result() const noexcept;
+private:
+    struct Impl;
+    Impl* d;
+};
+
+//! Parse t_raw fragment, any other value is returned as is.
+//! Strings reference fragment itself (escaped json strings are decoded into alloc)
+JsonView Materialize(JsonView raw, Arena& alloc, ParseSettings params = {});
+
 }
 
 #endif //JV_JSON_PARSER_HPP
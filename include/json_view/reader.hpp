@@ -0,0 +1,245 @@
+// This file is a part of RPCXX project
+
+/*
+Copyright 2024 "NEOLANT Service", "NEOLANT Kalinigrad", Alexey Doronin, Anastasia Lugovets, Dmitriy Dyakonov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef JV_READER_HPP
+#define JV_READER_HPP
+#pragma once
+
+#include "parse.hpp"
+
+namespace jv
+{
+
+//! Pull reader over t_raw fragment (json or msgpack). Values are consumed token by token,
+//! no DOM is built (except for Value() of containers). Strings reference fragment,
+//! escaped json strings are decoded into alloc
+class TokenReader {
+public:
+    TokenReader(JsonView raw, Arena& alloc, ParseSettings params = {});
+    TokenReader(TokenReader const&) = delete;
+    ~TokenReader();
+
+    //! Type of next value. Numbers are reported as t_number
+    Type Peek();
+    //! Scalars are returned as is, containers are parsed into alloc
+    JsonView Value();
+    //! Next value is validated, but dropped
+    void Skip();
+    //! Next value must be of matching type (see Peek())
+    void EnterObject();
+    void EnterArray();
+    //! Move to next member of entered container. Returns false once it is closed
+    bool NextKey(string_view& key);
+    bool NextItem();
+    //! Nothing but whitespace may follow top-level value
+    void Finish();
+
+    //! Type of top-level value of raw fragment (t_null if src is not t_raw or empty)
+    static Type PeekType(JsonView src) noexcept;
+private:
+    struct Impl;
+    Impl* d;
+};
+
+template<typename T>
+void ReadInto(TokenReader& reader, T& out, TraceFrame const& frame = {});
+
+//! Same as src.Get<T>(), but t_raw fragments are deserialized straight from their tokens.
+//! Described structs, optionals and containers are filled without building DOM, everything
+//! else (including types with own Convert<T>) is converted from Value() by Convert<T>,
+//! so errors and validators behave the same.
+//! Values are visited in input order: if there are several errors (including ones in values
+//! of duplicate keys, which DOM drops), other one may be reported
+template<typename T>
+T ReadAs(JsonView src, Arena& alloc, TraceFrame const& frame = {}) {
+    if (!src.Is(t_raw)) {
+        return src.Get<T>(frame);
+    }
+    TokenReader reader(src, alloc);
+    T result{};
+    ReadInto(reader, result, frame);
+    reader.Finish();
+    return result;
+}
+
+namespace detail {
+
+template<typename T>
+void readFields(TokenReader& reader, T& obj, TraceFrame const& frame) {
+    constexpr auto desc = describe::Get<T>();
+    bool hits[desc.fields_count ? desc.fields_count : 1] = {};
+    reader.EnterObject();
+    string_view key;
+    while (reader.NextKey(key)) {
+        bool found = false;
+        unsigned idx = 0;
+        desc.for_each([&](auto field){
+            if constexpr (field.is_field) {
+                if (!found && field.name == key) {
+                    found = true;
+                    auto& output = field.get(obj);
+                    if (std::exchange(hits[idx], true)) {
+                        // duplicate key: last one wins, as in DOM
+                        output = std::decay_t<decltype(output)>{};
+                    }
+                    ReadInto(reader, output, TraceFrame(field.name, frame));
+                }
+                idx++;
+            }
+        });
+        if (!found) {
+            reader.Skip();
+        }
+    }
+    unsigned idx = 0;
+    desc.for_each([&](auto field){
+        if constexpr (field.is_field) {
+            using F = decltype(field);
+            if constexpr (isRequired<F>()) {
+                if (!hits[idx]) {
+                    JsonView{}.throwKeyError(field.name, frame);
+                }
+            }
+            using validator = describe::extract_t<Validator, F>;
+            runValidator<validator>(field.get(obj), TraceFrame(field.name, frame));
+            idx++;
+        }
+    });
+}
+
+template<typename T>
+void readFromTuple(TokenReader& reader, T& obj, TraceFrame const& frame) {
+    constexpr auto desc = describe::Get<T>();
+    bool hits[desc.fields_count ? desc.fields_count : 1] = {};
+    reader.EnterArray();
+    unsigned size = 0;
+    for (; reader.NextItem(); ++size) {
+        bool found = false;
+        unsigned count = 0;
+        desc.for_each([&](auto f){
+            if constexpr (f.is_field) {
+                using Idx = describe::extract_t<FieldIndexBase, decltype(f)>;
+                unsigned index;
+                if constexpr (!std::is_void_v<Idx>) index = Idx::value;
+                else index = count;
+                if (!found && index == size) {
+                    found = true;
+                    hits[count] = true;
+                    ReadInto(reader, f.get(obj), TraceFrame(f.name, frame));
+                }
+                count++;
+            }
+        });
+        if (!found) {
+            reader.Skip();
+        }
+    }
+    unsigned count = 0;
+    desc.for_each([&](auto f){
+        if constexpr (f.is_field) {
+            using F = decltype(f);
+            using Idx = describe::extract_t<FieldIndexBase, F>;
+            unsigned index;
+            if constexpr (!std::is_void_v<Idx>) index = Idx::value;
+            else index = count;
+            auto& output = f.get(obj);
+            TraceFrame fieldFrame(f.name, frame);
+            if (!hits[count]) {
+                // same as tupleGet() for arrays which are too short
+                if constexpr (isRequired<F>()) {
+                    IndexError err(frame);
+                    err.actualSize = size;
+                    err.wanted = index;
+                    throw err;
+                } else {
+                    JsonView{}.GetTo(output, fieldFrame);
+                }
+            }
+            using validator = describe::extract_t<Validator, F>;
+            runValidator<validator>(output, fieldFrame);
+            count++;
+        }
+    });
+}
+
+} //detail
+
+template<typename T>
+void ReadInto(TokenReader& reader, T& out, TraceFrame const& frame) {
+    if constexpr (detail::hasOwnConvert<T>::value) {
+        Convert<T>::DoFromJson(out, reader.Value(), frame);
+    } else if constexpr (describe::is_described_struct_v<T>) {
+        constexpr bool asTuple = describe::has_v<StructAsTuple, T>;
+        if (reader.Peek() != (asTuple ? t_array : t_object)) {
+            // throws proper TypeMissmatch
+            return Convert<T>::DoFromJson(out, reader.Value(), frame);
+        }
+        if constexpr (asTuple) {
+            detail::readFromTuple(reader, out, frame);
+        } else {
+            detail::readFields(reader, out, frame);
+        }
+        using validator = describe::extract_t<Validator, T>;
+        detail::runValidator<validator>(out, TraceFrame(describe::Get<T>().name, frame));
+    } else if constexpr (is_optional<T>::value) {
+        if (reader.Peek() == t_null) {
+            (void)reader.Value();
+            out.reset();
+        } else {
+            ReadInto(reader, out.emplace(), frame);
+        }
+    } else if constexpr (std::is_convertible_v<T, string_view>) {
+        Convert<T>::DoFromJson(out, reader.Value(), frame);
+    } else if constexpr (meta::is_index_container_v<T>) {
+        if (reader.Peek() != t_array) {
+            return Convert<T>::DoFromJson(out, reader.Value(), frame);
+        }
+        out.clear();
+        reader.EnterArray();
+        for (unsigned count = 0; reader.NextItem(); ++count) {
+            ReadInto(reader, out.emplace_back(), TraceFrame(count, frame));
+        }
+    } else if constexpr (meta::is_assoc_container_v<T>) {
+        if (reader.Peek() != t_object) {
+            return Convert<T>::DoFromJson(out, reader.Value(), frame);
+        }
+        out.clear();
+        reader.EnterObject();
+        string_view key;
+        while (reader.NextKey(key)) {
+            auto size = out.size();
+            auto& output = out[typename T::key_type{key}];
+            if (out.size() == size) {
+                output = typename T::mapped_type{};
+            }
+            ReadInto(reader, output, TraceFrame(key, frame));
+        }
+    } else {
+        Convert<T>::DoFromJson(out, reader.Value(), frame);
+    }
+}
+
+}
+
+#endif //JV_READER_HPP
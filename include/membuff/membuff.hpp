@@ -28,6 +28,8 @@ SOFTWARE.
 #include <cstring>
 #include <string>
 #include <vector>
+#include <memory>
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include "meta/compiler_macros.hpp"
@@ -36,6 +38,7 @@ SOFTWARE.
 // These classes are used for half-virtual buffer implementations
 // Api is absolutely minimal - just one virt method to be implemented
 // membuff::Out::Grow(amount) -> try to allocate more space (or flush previous)
+// membuff::Out::Reference(data, size) -> optional: keep pointer to big chunk instead of copying
 // membuff::In::Refill(amount) -> try to get more data to read from buffer
 
 namespace membuff
@@ -66,6 +69,8 @@ struct Out
     size_t ptr = {};
     size_t capacity = {};
     long LastError = {};
+    //! See WriteRef(), 0 - nothing is referenced
+    size_t refThreshold = {};
 
     size_t SpaceLeft() const noexcept;
     char* Current() noexcept;
@@ -76,7 +81,12 @@ struct Out
     void Write(uint8_t byte, size_t growAmount = NoHint) {
         return Write(char(byte), growAmount);
     }
+    //! Same as Write(), but data of at least refThreshold bytes is passed to Reference(),
+    //! so implementation may keep pointer to it instead of copying. Data must outlive output then
+    void WriteRef(const char* data, size_t size);
     virtual void Grow(size_t amountHint) = 0;
+    //! Default is a plain Write()
+    virtual void Reference(const char* data, size_t size);
     virtual ~Out() = default;
 };
 
@@ -107,6 +117,58 @@ protected:
     String out;
 };
 
+//! Output as a list of segments, e.g. for writev()/sendmsg(). Small writes are copied into
+//! own chunks, but big strings and binaries are referenced in place (see Out::WriteRef())
+struct SegmentedOut final : Out {
+    struct Segment {
+        const char* data;
+        size_t size;
+    };
+    SegmentedOut(size_t threshold = 1024, size_t chunkSize = 4096) : chunkSize(chunkSize) {
+        refThreshold = threshold;
+    }
+    //! Valid until next write
+    std::vector<Segment> const& Segments() {
+        flush();
+        return segments;
+    }
+    size_t TotalSize() {
+        flush();
+        return total;
+    }
+    void Grow(size_t amount) override {
+        flush();
+        capacity = (std::max)(amount, chunkSize);
+        chunks.emplace_back(new char[capacity]);
+        buffer = chunks.back().get();
+        ptr = start = 0;
+    }
+    void Reference(const char* data, size_t size) override {
+        flush();
+        segments.push_back({data, size});
+        total += size;
+    }
+protected:
+    void flush() {
+        if (ptr == start) {
+            return;
+        }
+        auto size = ptr - start;
+        if (!segments.empty() && segments.back().data + segments.back().size == buffer + start) {
+            segments.back().size += size;
+        } else {
+            segments.push_back({buffer + start, size});
+        }
+        total += size;
+        start = ptr;
+    }
+    size_t chunkSize;
+    size_t start = 0;
+    size_t total = 0;
+    std::vector<Segment> segments;
+    std::vector<std::unique_ptr<char[]>> chunks;
+};
+
 template<size_t buff = 1024, typename Fn = void>
 struct FuncOut final : Out {
     FuncOut(Fn f) : f(std::move(f)) {
@@ -192,6 +254,20 @@ inline void Out::Write(std::string_view data, size_t growAmount)
     return Write(data.data(), data.size(), growAmount);
 }
 
+inline void Out::WriteRef(const char *data, size_t size)
+{
+    if (refThreshold && size >= refThreshold) {
+        Reference(data, size);
+    } else {
+        Write(data, size);
+    }
+}
+
+inline void Out::Reference(const char *data, size_t size)
+{
+    Write(data, size);
+}
+
 inline void Out::Write(char byte, size_t growAmount) {
     LastError = 0;
     if (meta_Unlikely(ptr >= capacity)) {
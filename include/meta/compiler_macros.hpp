@@ -38,15 +38,18 @@ SOFTWARE.
 
 #ifdef __GNUC__ // GCC, Clang, ICC
 #define meta_alwaysInline __attribute__((always_inline))
+#define meta_noInline __attribute__((noinline))
 #define meta_Unreachable() do{assert(false && "unreachable"); __builtin_unreachable();}while(0)
 #define meta_Restrict __restrict__
 #elif defined(_MSC_VER) // MSVC
 #define meta_Restrict
 #define meta_alwaysInline __forceinline
+#define meta_noInline __declspec(noinline)
 #define meta_Unreachable() do{assert(false && "unreachable"); __assume(false);}while(0)
 #else
 #define meta_Restrict
 #define meta_alwaysInline
+#define meta_noInline
 #define meta_Unreachable() do{assert(false && "unreachable");}while(0)
 #endif
 
@@ -29,6 +29,7 @@ SOFTWARE.
 #include "protocol.hpp"
 #include "transport.hpp"
 #include "rpcxx/utils.hpp"
+#include "json_view/reader.hpp"
 
 namespace rpcxx
 {
@@ -68,10 +69,16 @@ struct Client
         auto result = cb.GetFuture().ThenSync([](JsonView res) -> Ret {
             TraceFrame root;
             auto frame = TraceFrame("(rpc.result)", root);
-            if constexpr (std::is_void_v<Ret>) {
-                res.AssertType(t_null, frame);
+            if constexpr (std::is_same_v<Ret, JsonView>) {
+                return res;
             } else {
-                return res.Get<Ret>(frame);
+                DefaultArena alloc;
+                if constexpr (std::is_void_v<Ret>) {
+                    Materialize(res, alloc).AssertType(t_null, frame);
+                } else {
+                    // t_raw result is read straight into Ret
+                    return ReadAs<Ret>(res, alloc, frame);
+                }
             }
         });
         sendRequest(std::move(cb), method, params);
@@ -39,6 +39,25 @@ struct Fields {
     static constexpr string_view Error = proto == Protocol::json_v2_compliant ? "error" : "e";
 };
 
+//! Keeps 'params' and 'result' of incoming messages as raw slices of input.
+//! Server materializes params right before calling a handler, Client - result on conversion.
+//! Forwarded requests and responses are passed as is (without reparsing)
+template<Protocol proto>
+jv::ParseSettings LazyParseSettings(jv::ParseSettings base = {}) noexcept {
+    static constexpr string_view keys[] = {Fields<proto>::Params, Fields<proto>::Result};
+    base.rawKeys = keys;
+    base.rawKeysCount = 2;
+    return base;
+}
+
+inline jv::ParseSettings LazyParseSettings(Protocol proto, jv::ParseSettings base = {}) noexcept {
+    if (proto == Protocol::json_v2_compliant) {
+        return LazyParseSettings<Protocol::json_v2_compliant>(base);
+    } else {
+        return LazyParseSettings<Protocol::json_v2_minified>(base);
+    }
+}
+
 using millis = uint32_t;
 constexpr auto NoTimeout = (std::numeric_limits<millis>::max)();
 constexpr auto Compliant = std::integral_constant<Protocol, Protocol::json_v2_compliant>{};
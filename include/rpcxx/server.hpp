@@ -32,6 +32,8 @@ SOFTWARE.
 #include "transport.hpp"
 #include "meta/visit.hpp"
 #include "handler.hpp"
+#include "json_view/reader.hpp"
+#include "json_view/dump.hpp"
 #include <memory>
 
 namespace rpcxx
@@ -51,6 +53,10 @@ struct PackParams {
 namespace detail {
 template<typename T> T get(JsonView json, unsigned idx, TraceFrame& frame);
 template<typename T> T get(JsonView json, string_view key, TraceFrame& frame);
+template<typename...Ts, size_t...Is>
+void readPositional(JsonView params, Arena& alloc, std::tuple<Ts...>& args, TraceFrame& frame, std::index_sequence<Is...>);
+template<typename...Ts, typename Names, size_t...Is>
+void readNamed(JsonView params, Arena& alloc, std::tuple<Ts...>& args, Names& names, TraceFrame& frame, std::index_sequence<Is...>);
 template<typename T> struct is_pack : std::false_type {};
 template<typename T> struct is_pack<PackParams<T>> : std::true_type {};
 template<typename T> struct is_pack<const PackParams<T>> : std::true_type {};
@@ -123,6 +129,12 @@ struct Server : IHandler
     }
 
     void SetFallback(Fallback handler);
+    //! Results of methods (described structs and containers) are serialized straight into bytes
+    //! of this format and passed on as t_raw, without building JsonView::From() first.
+    //! Should match format of transports, otherwise results are transcoded when sent
+    void SetResultFormat(std::optional<RawFormat> format) noexcept {
+        resultFormat = format;
+    }
 
     template<typename Fn, typename Names = NoNames>
     void Method(string_view method, Fn handler, Names names = {}) {
@@ -188,7 +200,7 @@ private:
         registerCall(method, [=, MV(names), MV(handler)](CallCtx& ctx){
             constexpr auto args = TypeList<Args...>{};
             validateRequest(names, sizeof...(Args), ctx, true);
-            doCall(handler, ctx.req.params, names, args, args.idxs());
+            doCall(handler, ctx.req.params, ctx.alloc, names, args, args.idxs());
         });
     }
 
@@ -204,7 +216,7 @@ private:
                 cb(JsonView(nullptr));
             } else {
                 DefaultArena<512> alloc;
-                cb(JsonView::From(result.get(), alloc));
+                cb(self->intoResult(result.get(), alloc));
             }
         } catch (std::exception& e) {
             auto over = self->excHandlers("", method, std::move(ctx), e);
@@ -219,7 +231,7 @@ private:
             registerCall(method, [=, MV(names), MV(handler)](CallCtx& ctx){
                 constexpr auto args = TypeList<Args...>{};
                 validateRequest(names, sizeof...(Args), ctx);
-                doCall(handler, ctx.req.params, names, args, args.idxs())
+                doCall(handler, ctx.req.params, ctx.alloc, names, args, args.idxs())
                     .AtLast(GetExecutor(), Wrap<typename Ret::value_type>{
                         method, this, std::move(ctx.cb), ctx.req.context
                     });
@@ -229,21 +241,60 @@ private:
                 constexpr auto args = TypeList<Args...>{};
                 validateRequest(names, args.size, ctx);
                 if constexpr (std::is_void_v<Ret>) {
-                    doCall(handler, ctx.req.params, names, args, args.idxs());
+                    doCall(handler, ctx.req.params, ctx.alloc, names, args, args.idxs());
                     ctx.cb(nullptr);
                 } else {
-                    auto ret = doCall(handler, ctx.req.params, names, args, args.idxs());
-                    ctx.cb(JsonView::From(ret, ctx.alloc));
+                    auto ret = doCall(handler, ctx.req.params, ctx.alloc, names, args, args.idxs());
+                    ctx.cb(intoResult(ret, ctx.alloc));
                 }
             });
         }
     }
+    template<typename T>
+    JsonView intoResult(T const& value, Arena& alloc) {
+        constexpr bool composite = describe::is_described_struct_v<T>
+                                   || ::meta::is_index_container_v<T>
+                                   || ::meta::is_assoc_container_v<T>;
+        if constexpr (composite && !std::is_convertible_v<T, string_view>) {
+            if (resultFormat) {
+                // bytes stay in alloc: arena_allocator never frees
+                membuff::StringOut<ArenaString> out(256, arena_allocator<char>(alloc));
+                if (*resultFormat == RawFormat::msgpack) {
+                    SerializeMsgPack(out, value);
+                } else {
+                    SerializeJson(out, value);
+                }
+                auto bytes = out.Consume();
+                return JsonView::Raw(string_view{bytes}, *resultFormat);
+            }
+        }
+        return JsonView::From(value, alloc);
+    }
     template<typename Fn, typename Names, typename...Args, size_t...Is>
-    static auto doCall(Fn& fn, JsonView params, Names& names, TypeList<Args...>, std::index_sequence<Is...>)
+    static auto doCall(Fn& fn, JsonView params, Arena& alloc, Names& names, TypeList<Args...>, std::index_sequence<Is...>)
     {
         TraceFrame root;
         TraceFrame frame("<params>", root);
         (void)params;
+        (void)alloc;
+        if constexpr (sizeof...(Args) > 0) {
+            if (params.Is(t_raw)) {
+                // arguments are read straight from params tokens, without DOM
+                std::tuple<std::decay_t<Args>...> args;
+                try {
+                    if constexpr (std::is_same_v<Names, const NoNames>) {
+                        detail::readPositional(params, alloc, args, frame, std::index_sequence<Is...>{});
+                    } else if constexpr (detail::is_pack<Names>::value) {
+                        std::get<0>(args) = jv::ReadAs<typename Names::type>(params, alloc, frame);
+                    } else {
+                        detail::readNamed(params, alloc, args, names, frame, std::index_sequence<Is...>{});
+                    }
+                } catch (jv::ParsingError& e) {
+                    throw RpcException(string{"Invalid params: "} + e.what(), ErrorCode::parse);
+                }
+                return fn(std::get<Is>(std::move(args))...);
+            }
+        }
         if constexpr (std::is_same_v<Names, const NoNames>) {
             return fn(detail::get<std::decay_t<Args>>(params, Is, frame)...);
         } else if constexpr (detail::is_pack<Names>::value) {
@@ -286,6 +337,7 @@ private:
     void doHandle(uint32_t internal, JsonView req, uint32_t timeout);
     void handleExtension(CallCtx &ctx);
 
+    std::optional<RawFormat> resultFormat;
     struct Impl;
     FastPimpl<Impl, 192> d;
 };
@@ -307,6 +359,67 @@ template<typename T> T get(JsonView json, string_view key, TraceFrame& frame) {
         return json.At(key, frame).Get<T>(next);
     }
 }
+
+// Same errors as get() above, but for t_raw params
+template<typename...Ts, size_t...Is>
+void readPositional(JsonView params, Arena& alloc, std::tuple<Ts...>& args, TraceFrame& frame, std::index_sequence<Is...>) {
+    jv::TokenReader reader(params, alloc);
+    reader.EnterArray();
+    unsigned size = 0;
+    bool more = true;
+    auto read = [&](auto& out, unsigned idx) {
+        TraceFrame next(idx, frame);
+        if (more && (more = reader.NextItem())) {
+            size++;
+            jv::ReadInto(reader, out, next);
+        } else if constexpr (!is_optional_v<std::decay_t<decltype(out)>>) {
+            IndexError err(next);
+            err.actualSize = size;
+            err.wanted = idx;
+            throw err;
+        }
+    };
+    (read(std::get<Is>(args), Is), ...);
+    if (more) {
+        while (reader.NextItem()) {
+            reader.Skip();
+        }
+    }
+    reader.Finish();
+}
+
+template<typename...Ts, typename Names, size_t...Is>
+void readNamed(JsonView params, Arena& alloc, std::tuple<Ts...>& args, Names& names, TraceFrame& frame, std::index_sequence<Is...>) {
+    jv::TokenReader reader(params, alloc);
+    reader.EnterObject();
+    bool hits[sizeof...(Ts)] = {};
+    string_view key;
+    while (reader.NextKey(key)) {
+        bool found = false;
+        auto read = [&](auto& out, unsigned idx) {
+            if (!found && names[idx] == key) {
+                found = true;
+                if (std::exchange(hits[idx], true)) {
+                    out = std::decay_t<decltype(out)>{};
+                }
+                jv::ReadInto(reader, out, TraceFrame(key, frame));
+            }
+        };
+        (read(std::get<Is>(args), Is), ...);
+        if (!found) {
+            reader.Skip();
+        }
+    }
+    reader.Finish();
+    auto check = [&](auto& out, unsigned idx) {
+        if constexpr (!is_optional_v<std::decay_t<decltype(out)>>) {
+            if (!hits[idx]) {
+                JsonView{}.throwKeyError(names[idx], frame);
+            }
+        }
+    };
+    (check(std::get<Is>(args), Is), ...);
+}
 }
 
 } //rpcxx
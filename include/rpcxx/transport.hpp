@@ -76,6 +76,12 @@ struct IAsyncTransport : IClientTransport {
     void CheckTimeouts();
     void Receive(JsonView msg, ContextPtr ctx);
     void Receive(JsonView msg);
+    //! Limit of arena used while handling received messages (see DefaultArena::SetLimit()),
+    //! 0 if unlimited. It counts all blocks of arena: spare ones, and those still used by outer
+    //! Receive() if replies are received synchronously, so nested ones get less. Exceeding it
+    //! fails the request with std::bad_alloc. Message itself is parsed by caller before Receive():
+    //! to cap memory taken by huge params set DefaultArena::SetLimit() on arena of parser
+    void SetArenaLimit(size_t bytes) noexcept;
 
     ~IAsyncTransport() override;
     IAsyncTransport(const IAsyncTransport&) = delete;
@@ -85,13 +91,15 @@ protected:
     virtual void Send(JsonView msg) = 0;
     virtual void TimeoutHappened(string_view method, Promise<JsonView>& target);
     virtual void NoServerFound();
+    //! Called after each Receive() (also if it throws) with memory used by it, e.g. for metrics
+    virtual void OnReceiveStats(JsonView msg, ArenaStats const& stats) noexcept;
 private:
     void SendBatch(Batch batch) final;
     void SendNotify(string_view method, JsonView params) final;
     void SendMethod(Method method, JsonView params, Promise<JsonView> cb) final;
 
     struct Impl;
-    FastPimpl<Impl, 144> d;
+    FastPimpl<Impl, 256> d;
 };
 
 struct Transport final : IAsyncTransport {
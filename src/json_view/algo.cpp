@@ -24,6 +24,7 @@ SOFTWARE.
 
 #include "json_view/algo.hpp"
 #include "json_view/pointer.hpp"
+#include "json_view/parse.hpp"
 #include "meta/visit.hpp"
 #include <map>
 
@@ -43,41 +44,126 @@ JsonView jv::Flatten(JsonView src, Arena& alloc, unsigned int depth)
 }
 
 namespace {
+
+//! Whole copy goes into one block: node arrays first, then all strings (which need no alignment).
+//! Saves an allocation per string and padding after each of them, and keeps the copy compact
+struct Packed {
+    char* nodes;
+    char* strings;
+
+    string_view String(string_view src) noexcept {
+        if (src.empty()) return "";
+        ::memcpy(strings, src.data(), src.size());
+        return {std::exchange(strings, strings + src.size()), src.size()};
+    }
+    template<typename T>
+    T* Nodes(unsigned count) noexcept {
+        if (!count) return nullptr;
+        return reinterpret_cast<T*>(std::exchange(nodes, nodes + sizeof(T) * count));
+    }
+};
+
+struct CopySize {
+    size_t nodes = 0;
+    size_t strings = 0;
+};
+
 template<unsigned flags>
-JsonView doCopy(JsonView src, Arena& alloc, unsigned int depth) {
+void countCopy(JsonView src, CopySize& size, unsigned int depth) {
     DepthError::Check(depth--);
+    constexpr bool strings = !(flags & NoCopyStrings);
+    auto& data = src.GetUnsafe();
+    switch (src.GetType()) {
+    case t_binary: {
+        if (strings) size.strings += src.GetBinary().size();
+        break;
+    }
+    case t_string: {
+        if (strings) size.strings += src.GetStringUnsafe().size();
+        break;
+    }
+    case t_raw: {
+        if (strings) size.strings += src.GetRaw().size();
+        break;
+    }
+    case t_number:
+    case t_signed:
+    case t_unsigned: {
+        if (strings && src.HasFlag(f_lazy_number)) size.strings += src.GetNumberText().size();
+        break;
+    }
+    case t_array: {
+        size.nodes += sizeof(JsonView) * data.size;
+        for (auto i = 0u; i < data.size; ++i) {
+            countCopy<flags>(data.d.array[i], size, depth);
+        }
+        break;
+    }
+    case t_object: {
+        size.nodes += sizeof(JsonPair) * data.size;
+        for (auto i = 0u; i < data.size; ++i) {
+            if (strings) size.strings += data.d.object[i].key.size();
+            countCopy<flags>(data.d.object[i].value, size, depth);
+        }
+        break;
+    }
+    default: {
+        break;
+    }
+    }
+}
+
+template<unsigned flags>
+JsonView doCopy(JsonView src, Packed& out) {
     switch (src.GetType()) {
     case t_binary: {
         if (flags & NoCopyStrings) {
             return src;
         } else {
-            return JsonView::Binary(CopyString(src.GetBinary(), alloc));
+            return JsonView::Binary(out.String(src.GetBinary()));
         }
     }
     case t_string: {
         if (flags & NoCopyStrings) {
             return src;
         } else {
-            return JsonView(CopyString(src.GetString(), alloc));
+            return JsonView(out.String(src.GetString()));
+        }
+    }
+    case t_raw: {
+        if (flags & NoCopyStrings) {
+            return src;
+        } else {
+            return JsonView::Raw(out.String(src.GetRaw()), src.GetRawFormat());
+        }
+    }
+    case t_number:
+    case t_signed:
+    case t_unsigned: {
+        if (flags & NoCopyStrings || !src.HasFlag(f_lazy_number)) {
+            return src;
+        } else {
+            auto text = out.String(src.GetNumberText());
+            return JsonView::LazyNumber(text, src.GetType()).WithFlagsUnsafe(src.GetFlags());
         }
     }
     case t_array: {
-        auto arr = MakeArrayOf(src.GetUnsafe().size, alloc);
+        auto arr = out.Nodes<JsonView>(src.GetUnsafe().size);
         for (auto i = 0u; i < src.GetUnsafe().size; ++i) {
-            arr[i] = doCopy<flags>(src.GetUnsafe().d.array[i], alloc, depth);
+            arr[i] = doCopy<flags>(src.GetUnsafe().d.array[i], out);
         }
         return JsonView{arr, src.GetUnsafe().size}.WithFlagsUnsafe(src.GetFlags());
     }
     case t_object: {
-        auto obj = MakeObjectOf(src.GetUnsafe().size, alloc);
+        auto obj = out.Nodes<JsonPair>(src.GetUnsafe().size);
         for (auto i = 0u; i < src.GetUnsafe().size; ++i) {
             auto& curr = src.GetUnsafe().d.object[i];
             if (flags & NoCopyStrings) {
                 obj[i].key = curr.key;
             } else {
-                obj[i].key = CopyString(curr.key, alloc);
+                obj[i].key = out.String(curr.key);
             }
-            obj[i].value = doCopy<flags>(curr.value, alloc, depth);
+            obj[i].value = doCopy<flags>(curr.value, out);
         }
         return JsonView{obj, src.GetUnsafe().size, JsonView::sorted_tag{}}.WithFlagsUnsafe(src.GetFlags());
     }
@@ -86,19 +172,31 @@ JsonView doCopy(JsonView src, Arena& alloc, unsigned int depth) {
     }
     }
 }
+
+template<unsigned flags>
+JsonView packedCopy(JsonView src, Arena& alloc, unsigned int depth) {
+    CopySize size;
+    countCopy<flags>(src, size, depth);
+    Packed out{nullptr, nullptr};
+    if (auto total = size.nodes + size.strings) {
+        out.nodes = static_cast<char*>(alloc(total, alignof(JsonPair)));
+        out.strings = out.nodes + size.nodes;
+    }
+    return doCopy<flags>(src, out);
+}
 }
 
 JsonView jv::Copy(JsonView src, Arena& alloc, unsigned int depth, unsigned flags)
 {
     switch (flags) {
     case NoCopyStrings: {
-        return doCopy<NoCopyStrings>(src, alloc, depth);
+        return packedCopy<NoCopyStrings>(src, alloc, depth);
     }
     case NoCopyBinary: {
-        return doCopy<NoCopyBinary>(src, alloc, depth);
+        return packedCopy<NoCopyBinary>(src, alloc, depth);
     }
     default: {
-        return doCopy<0>(src, alloc, depth);
+        return packedCopy<0>(src, alloc, depth);
     }
     }
 }
@@ -109,6 +207,17 @@ bool jv::DeepEqual(JsonView lhs, JsonView rhs, unsigned int depth, double margin
     auto& data = lhs.GetUnsafe();
     auto& other = rhs.GetUnsafe();
     constexpr auto numType = t_signed | t_unsigned;
+    if (meta_Unlikely((data.type | other.type) & t_raw)) {
+        if (data.type == other.type && lhs.GetRawFormat() == rhs.GetRawFormat()
+            && lhs.GetRaw() == rhs.GetRaw()) {
+            return true;
+        }
+        DefaultArena alloc;
+        return DeepEqual(Materialize(lhs, alloc), Materialize(rhs, alloc), depth, margin);
+    }
+    if (meta_Unlikely((data.flags | other.flags) & f_lazy_number)) {
+        return DeepEqual(lhs.ParsedNumber(), rhs.ParsedNumber(), depth, margin);
+    }
     switch (data.type) {
     case t_signed:
     case t_unsigned: {
@@ -0,0 +1,291 @@
+// This file is a part of RPCXX project
+
+/*
+Copyright 2024 "NEOLANT Service", "NEOLANT Kalinigrad", Alexey Doronin, Anastasia Lugovets, Dmitriy Dyakonov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "json_view/alloc.hpp"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#if __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#define JV_HAS_MMAP 1
+#endif
+
+using namespace jv;
+
+namespace {
+
+constexpr unsigned minShift = 12;
+constexpr unsigned maxShift = 20;
+constexpr unsigned classes = maxShift - minShift + 1;
+
+std::atomic<size_t> perThreadLimit{ArenaPoolLimits{}.perThread};
+std::atomic<size_t> sharedLimit{ArenaPoolLimits{}.shared};
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+//! Returns false if blocks of this size are not pooled
+bool sizeClass(size_t size, unsigned& cls) noexcept {
+    if (size < (size_t(1) << minShift) || size > (size_t(1) << maxShift) || (size & (size - 1))) {
+        return false;
+    }
+    cls = 0;
+    while ((size_t(1) << (minShift + cls)) != size) {
+        cls++;
+    }
+    return true;
+}
+
+void* allocBlock(size_t size) {
+    return ::operator new(size, std::align_val_t(Arena::max_align));
+}
+
+void freeBlock(void* block) noexcept {
+    ::operator delete(block, std::align_val_t(Arena::max_align));
+}
+
+struct Lists {
+    FreeBlock* heads[classes] = {};
+    size_t bytes = 0;
+
+    void* pop(unsigned cls) noexcept {
+        auto head = heads[cls];
+        if (head) {
+            heads[cls] = head->next;
+            bytes -= size_t(1) << (minShift + cls);
+        }
+        return head;
+    }
+    void push(void* block, unsigned cls) noexcept {
+        auto b = static_cast<FreeBlock*>(block);
+        b->next = heads[cls];
+        heads[cls] = b;
+        bytes += size_t(1) << (minShift + cls);
+    }
+    void release() noexcept {
+        for (auto& head: heads) {
+            while (head) {
+                freeBlock(std::exchange(head, head->next));
+            }
+        }
+        bytes = 0;
+    }
+};
+
+struct Shared {
+    std::mutex mut;
+    Lists lists;
+};
+
+//! Never destroyed: arenas may outlive static objects
+Shared& shared() noexcept {
+    static Shared* result = new Shared;
+    return *result;
+}
+
+bool putShared(void* block, unsigned cls) noexcept {
+    auto limit = sharedLimit.load(std::memory_order_relaxed);
+    if (!limit) {
+        return false;
+    }
+    auto& sh = shared();
+    std::lock_guard lock(sh.mut);
+    if (sh.lists.bytes + (size_t(1) << (minShift + cls)) > limit) {
+        return false;
+    }
+    sh.lists.push(block, cls);
+    return true;
+}
+
+void* takeShared(unsigned cls) noexcept {
+    if (!sharedLimit.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    auto& sh = shared();
+    std::lock_guard lock(sh.mut);
+    return sh.lists.pop(cls);
+}
+
+// Set when cache of this thread is destroyed: arenas which die later (e.g. in other
+// thread_local or static objects) free their blocks directly
+thread_local bool cacheGone = false;
+
+struct ThreadCache {
+    Lists lists;
+    ArenaPoolStats stats;
+
+    ~ThreadCache() {
+        for (unsigned cls = 0; cls < classes; ++cls) {
+            while (auto block = lists.pop(cls)) {
+                if (!putShared(block, cls)) {
+                    freeBlock(block);
+                }
+            }
+        }
+        cacheGone = true;
+    }
+};
+
+ThreadCache* threadCache() noexcept {
+    if (meta_Unlikely(cacheGone)) {
+        return nullptr;
+    }
+    thread_local ThreadCache cache;
+    return &cache;
+}
+
+}
+
+void* jv::detail::takeBlock(size_t size)
+{
+    unsigned cls;
+    auto cache = threadCache();
+    if (sizeClass(size, cls) && cache) {
+        auto block = cache->lists.pop(cls);
+        if (!block) {
+            block = takeShared(cls);
+        }
+        if (block) {
+            cache->stats.reused++;
+            return block;
+        }
+    }
+    if (cache) {
+        cache->stats.allocated++;
+    }
+    return allocBlock(size);
+}
+
+void jv::detail::putBlock(void* block, size_t size) noexcept
+{
+    unsigned cls;
+    auto cache = threadCache();
+    if (sizeClass(size, cls) && cache) {
+        if (cache->lists.bytes + size <= perThreadLimit.load(std::memory_order_relaxed)) {
+            cache->lists.push(block, cls);
+            cache->stats.recycled++;
+            return;
+        }
+        if (putShared(block, cls)) {
+            cache->stats.recycled++;
+            return;
+        }
+    }
+    if (cache) {
+        cache->stats.freed++;
+    }
+    freeBlock(block);
+}
+
+#ifdef JV_HAS_MMAP
+void* jv::detail::mapBlock(size_t size)
+{
+    // over-map and trim, so that huge pages may cover whole block except its tail
+    auto total = size + hugePage;
+    auto raw = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        throw std::bad_alloc{};
+    }
+    auto begin = reinterpret_cast<uintptr_t>(raw);
+    auto aligned = (begin + hugePage - 1) & ~uintptr_t(hugePage - 1);
+    if (aligned != begin) {
+        ::munmap(raw, aligned - begin);
+    }
+    if (auto tail = begin + total - (aligned + size)) {
+        ::munmap(reinterpret_cast<void*>(aligned + size), tail);
+    }
+#ifdef MADV_HUGEPAGE
+    // only a hint: transparent huge pages may be disabled
+    ::madvise(reinterpret_cast<void*>(aligned), size, MADV_HUGEPAGE);
+#endif
+    if (auto cache = threadCache()) {
+        cache->stats.allocated++;
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+
+void jv::detail::unmapBlock(void* block, size_t size) noexcept
+{
+    if (auto cache = threadCache()) {
+        cache->stats.freed++;
+    }
+    ::munmap(block, size);
+}
+#else
+void* jv::detail::mapBlock(size_t size)
+{
+    if (auto cache = threadCache()) {
+        cache->stats.allocated++;
+    }
+    return ::operator new(size, std::align_val_t(hugePage));
+}
+
+void jv::detail::unmapBlock(void* block, size_t) noexcept
+{
+    if (auto cache = threadCache()) {
+        cache->stats.freed++;
+    }
+    ::operator delete(block, std::align_val_t(hugePage));
+}
+#endif
+
+void jv::SetArenaPoolLimits(ArenaPoolLimits limits) noexcept
+{
+    perThreadLimit.store(limits.perThread, std::memory_order_relaxed);
+    sharedLimit.store(limits.shared, std::memory_order_relaxed);
+}
+
+ArenaPoolLimits jv::GetArenaPoolLimits() noexcept
+{
+    ArenaPoolLimits result;
+    result.perThread = perThreadLimit.load(std::memory_order_relaxed);
+    result.shared = sharedLimit.load(std::memory_order_relaxed);
+    return result;
+}
+
+ArenaPoolStats jv::GetArenaPoolStats() noexcept
+{
+    ArenaPoolStats result;
+    if (auto cache = threadCache()) {
+        result = cache->stats;
+        result.threadCached = cache->lists.bytes;
+    }
+    auto& sh = shared();
+    std::lock_guard lock(sh.mut);
+    result.sharedCached = sh.lists.bytes;
+    return result;
+}
+
+void jv::TrimArenaPool(bool trimShared) noexcept
+{
+    if (auto cache = threadCache()) {
+        cache->lists.release();
+    }
+    if (trimShared) {
+        auto& sh = shared();
+        std::lock_guard lock(sh.mut);
+        sh.lists.release();
+    }
+}
@@ -42,6 +42,9 @@ struct RapidArenaAllocator {
         if (!cap) {
             return nullptr;
         }
+        if (data && alloc->TryExtend(data, was, cap)) {
+            return data;
+        }
         auto ptr = Malloc(cap);
         memcpy(ptr, data, was);
         return ptr;
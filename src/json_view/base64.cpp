@@ -0,0 +1,323 @@
+// This file is a part of RPCXX project
+
+/*
+Copyright 2024 "NEOLANT Service", "NEOLANT Kalinigrad", Alexey Doronin, Anastasia Lugovets, Dmitriy Dyakonov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "json_view/base64.hpp"
+#include "json_sax.hpp"
+#include <array>
+
+using namespace jv;
+
+namespace {
+
+// Bulk kernels handle whole blocks only and advance src/out past them.
+// Tails (and blocks with invalid chars, when decoding) are left to scalar code
+
+constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+constexpr auto decodeTable = []{
+    std::array<uint8_t, 256> res{};
+    for (auto& v: res) {
+        v = 0xFF;
+    }
+    for (unsigned i = 0; i < 64; ++i) {
+        res[uint8_t(alphabet[i])] = uint8_t(i);
+    }
+    return res;
+}();
+
+using EncodeBlocks = void(*)(const uint8_t*& src, const uint8_t* end, char*& out);
+using DecodeBlocks = void(*)(const char*& src, const char* end, char*& out);
+
+struct Kernels {
+    EncodeBlocks encode;
+    DecodeBlocks decode;
+};
+
+[[maybe_unused]]
+static void encodeNone(const uint8_t*&, const uint8_t*, char*&) noexcept {}
+[[maybe_unused]]
+static void decodeNone(const char*&, const char*, char*&) noexcept {}
+
+#if JV_SIMD_AVX2
+// 12 bytes in each 128 bit lane (at offset 4 in low one) -> 16 sextets in low bits of bytes.
+// Same shuffle and multiply scheme as in SSSE3 version, see below
+__attribute__((target("avx2")))
+static __m256i encodeReshuffleAVX2(__m256i in) noexcept {
+    in = _mm256_shuffle_epi8(in, _mm256_set_epi8(
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+        14, 15, 13, 14, 11, 12, 10, 11, 8, 9, 7, 8, 5, 6, 4, 5));
+    auto t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00));
+    auto t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    auto t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0));
+    auto t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(t1, t3);
+}
+
+// Sextets -> alphabet: offset of each range is picked by pshufb
+__attribute__((target("avx2")))
+static __m256i encodeTranslateAVX2(__m256i in) noexcept {
+    const auto lut = _mm256_setr_epi8(
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    auto idx = _mm256_subs_epu8(in, _mm256_set1_epi8(51));
+    idx = _mm256_sub_epi8(idx, _mm256_cmpgt_epi8(in, _mm256_set1_epi8(25)));
+    return _mm256_add_epi8(in, _mm256_shuffle_epi8(lut, idx));
+}
+
+__attribute__((target("avx2")))
+static void encodeAVX2(const uint8_t*& src, const uint8_t* end, char*& out) noexcept {
+    // 32 bytes are loaded, 24 are used
+    while (end - src >= 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6));
+        v = encodeTranslateAVX2(encodeReshuffleAVX2(v));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+        src += 24;
+        out += 32;
+    }
+}
+
+__attribute__((target("avx2")))
+static void decodeAVX2(const char*& src, const char* end, char*& out) noexcept {
+    const auto lutLo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const auto lutHi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const auto lutRoll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const auto mask2F = _mm256_set1_epi8(0x2F);
+    // 32 bytes are stored, 24 are used: at least 8 more must be decoded after the block
+    while (end - src >= 45) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        auto hiNibbles = _mm256_and_si256(_mm256_srli_epi32(v, 4), mask2F);
+        auto loNibbles = _mm256_and_si256(v, mask2F);
+        auto hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+        auto lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+        if (!_mm256_testz_si256(lo, hi)) {
+            break;
+        }
+        auto eq2F = _mm256_cmpeq_epi8(v, mask2F);
+        v = _mm256_add_epi8(v, _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles)));
+        // sextets -> 3 bytes in each dword, then packed together
+        auto merged = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        v = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+        src += 32;
+        out += 24;
+    }
+}
+
+// Each dword of 3 bytes is spread into 4 bytes, then sextets are moved
+// to low bits of each byte: multiply by power of two is used as a shift
+__attribute__((target("ssse3")))
+static void encodeSSSE3(const uint8_t*& src, const uint8_t* end, char*& out) noexcept {
+    const auto lut = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    // 16 bytes are loaded, 12 are used
+    while (end - src >= 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        v = _mm_shuffle_epi8(v, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+        auto t0 = _mm_and_si128(v, _mm_set1_epi32(0x0FC0FC00));
+        auto t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        auto t2 = _mm_and_si128(v, _mm_set1_epi32(0x003F03F0));
+        auto t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        v = _mm_or_si128(t1, t3);
+        auto idx = _mm_subs_epu8(v, _mm_set1_epi8(51));
+        idx = _mm_sub_epi8(idx, _mm_cmpgt_epi8(v, _mm_set1_epi8(25)));
+        v = _mm_add_epi8(v, _mm_shuffle_epi8(lut, idx));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+        src += 12;
+        out += 16;
+    }
+}
+
+// Chars are validated by nibbles: lutLo/lutHi have common bit only for invalid ones.
+// Then offset of each char range is added (lutRoll), '/' is the only char which needs
+// more than high nibble to find its range
+__attribute__((target("ssse3")))
+static void decodeSSSE3(const char*& src, const char* end, char*& out) noexcept {
+    const auto lutLo = _mm_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const auto lutHi = _mm_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const auto lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const auto mask2F = _mm_set1_epi8(0x2F);
+    // 16 bytes are stored, 12 are used: at least 4 more must be decoded after the block
+    while (end - src >= 22) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        auto hiNibbles = _mm_and_si128(_mm_srli_epi32(v, 4), mask2F);
+        auto loNibbles = _mm_and_si128(v, mask2F);
+        auto hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+        auto lo = _mm_shuffle_epi8(lutLo, loNibbles);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128()))) {
+            break;
+        }
+        auto eq2F = _mm_cmpeq_epi8(v, mask2F);
+        v = _mm_add_epi8(v, _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles)));
+        auto merged = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+        v = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        v = _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+        src += 16;
+        out += 12;
+    }
+}
+#endif
+
+static Kernels pickKernels() noexcept {
+#if JV_SIMD_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {encodeAVX2, decodeAVX2};
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return {encodeSSSE3, decodeSSSE3};
+    }
+#endif
+    return {encodeNone, decodeNone};
+}
+
+static const Kernels& kernels() noexcept {
+    static const Kernels result = pickKernels();
+    return result;
+}
+
+//! Padding is dropped, if text is padded properly
+static const char* unpadded(string_view text) noexcept {
+    auto end = text.data() + text.size();
+    if (text.size() && text.size() % 4 == 0 && end[-1] == '=') {
+        end -= end[-2] == '=' ? 2 : 1;
+    }
+    return end;
+}
+
+}
+
+char* jv::EncodeBase64(char* out, string_view data) noexcept
+{
+    auto src = reinterpret_cast<const uint8_t*>(data.data());
+    auto end = src + data.size();
+    kernels().encode(src, end, out);
+    for (; end - src >= 3; src += 3) {
+        auto v = unsigned(src[0]) << 16 | unsigned(src[1]) << 8 | src[2];
+        *out++ = alphabet[v >> 18];
+        *out++ = alphabet[(v >> 12) & 63];
+        *out++ = alphabet[(v >> 6) & 63];
+        *out++ = alphabet[v & 63];
+    }
+    if (end != src) {
+        auto v = unsigned(src[0]) << 16 | (end - src == 2 ? unsigned(src[1]) << 8 : 0);
+        *out++ = alphabet[v >> 18];
+        *out++ = alphabet[(v >> 12) & 63];
+        *out++ = end - src == 2 ? alphabet[(v >> 6) & 63] : '=';
+        *out++ = '=';
+    }
+    return out;
+}
+
+size_t jv::Base64DecodedSize(string_view text) noexcept
+{
+    auto len = size_t(unpadded(text) - text.data());
+    auto tail = len % 4;
+    return len / 4 * 3 + (tail > 1 ? tail - 1 : 0);
+}
+
+char* jv::DecodeBase64(char* out, string_view text) noexcept
+{
+    auto src = text.data();
+    auto end = unpadded(text);
+    if (meta_Unlikely(size_t(end - src) % 4 == 1)) {
+        return nullptr;
+    }
+    kernels().decode(src, end, out);
+    for (; end - src >= 4; src += 4) {
+        uint32_t a = decodeTable[uint8_t(src[0])];
+        uint32_t b = decodeTable[uint8_t(src[1])];
+        uint32_t c = decodeTable[uint8_t(src[2])];
+        uint32_t d = decodeTable[uint8_t(src[3])];
+        if (meta_Unlikely((a | b | c | d) & 0x80)) {
+            return nullptr;
+        }
+        auto v = a << 18 | b << 12 | c << 6 | d;
+        *out++ = char(v >> 16);
+        *out++ = char(v >> 8);
+        *out++ = char(v);
+    }
+    if (end != src) {
+        uint32_t a = decodeTable[uint8_t(src[0])];
+        uint32_t b = decodeTable[uint8_t(src[1])];
+        uint32_t c = end - src == 3 ? decodeTable[uint8_t(src[2])] : 0;
+        if (meta_Unlikely((a | b | c) & 0x80)) {
+            return nullptr;
+        }
+        auto v = a << 18 | b << 12 | c << 6;
+        *out++ = char(v >> 16);
+        if (end - src == 3) {
+            *out++ = char(v >> 8);
+        }
+    }
+    return out;
+}
+
+JsonView jv::DecodeBinary(JsonView json, Arena& alloc, TraceFrame const& frame)
+{
+    if (json.Is(t_binary)) {
+        return json;
+    }
+    if (!json.Is(t_string)) {
+        json.throwMissmatch(t_binary | t_string, frame);
+    }
+    auto text = json.GetStringUnsafe();
+    auto buff = static_cast<char*>(alloc(Base64DecodedSize(text), alignof(char)));
+    auto end = DecodeBase64(buff, text);
+    if (meta_Unlikely(!end)) {
+        throw ForeignError("invalid base64 string", frame);
+    }
+    return JsonView::Binary({buff, size_t(end - buff)});
+}
+
+void jv::Convert<Bytes>::DoFromJson(Bytes& value, JsonView json, TraceFrame const& frame)
+{
+    if (json.Is(t_binary)) {
+        auto bin = json.GetBinaryUnsafe();
+        value.assign(bin.begin(), bin.end());
+        return;
+    }
+    if (!json.Is(t_string)) {
+        json.throwMissmatch(t_binary | t_string, frame);
+    }
+    auto text = json.GetStringUnsafe();
+    value.resize(Base64DecodedSize(text));
+    auto end = DecodeBase64(value.data(), text);
+    if (meta_Unlikely(!end)) {
+        throw ForeignError("invalid base64 string", frame);
+    }
+    value.resize(size_t(end - value.data()));
+}
@@ -22,123 +22,686 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include "json_view/base64.hpp"
 #include "json_view/dump.hpp"
+#include "json_view/parse.hpp"
 #include <charconv>
-#include "rapidjson/internal/strtod.h"
-#include "rapidjson/writer.h"
-#include "rapidjson/prettywriter.h"
-#include "alloc_adapter.hpp"
+#include <cmath>
+#include <cstdio>
+#include "json_sax.hpp"
 
 using namespace jv;
 using namespace std::string_view_literals;
-using namespace rapidjson;
 
 namespace {
 
-struct Stream {
-    using Ch = char;
-    membuff::Out &out;
-    void PutUnsafe(char ch) {
-        out.Write(ch);
+//! Shortest roundtrip representation, formatted same way as rapidjson Writer did:
+//! '1.0', '0.001', '1e21', '1.5e-7'. NaN and Inf are written as null
+static char* writeDouble(char* out, double v) noexcept {
+    if (meta_Unlikely(!std::isfinite(v))) {
+        ::memcpy(out, "null", 4);
+        return out + 4;
     }
-    void Put(char ch) {
-        out.Write(ch);
+    if (std::signbit(v)) {
+        *out++ = '-';
+        v = -v;
     }
-    void Flush() {}
-};
+    if (v == 0) {
+        ::memcpy(out, "0.0", 3);
+        return out + 3;
+    }
+    char sci[40];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto sciEnd = std::to_chars(sci, sci + sizeof(sci), v, std::chars_format::scientific).ptr;
+#else
+    auto sciEnd = sci + std::snprintf(sci, sizeof(sci), "%.16e", v);
+#endif
+    // d[.ddd]e(+|-)xx => digits * 10^k
+    char digits[24];
+    int len = 0;
+    auto p = sci;
+    for (; *p != 'e'; ++p) {
+        if (*p != '.') digits[len++] = *p;
+    }
+    while (len > 1 && digits[len - 1] == '0') {
+        --len;
+    }
+    bool negExp = p[1] == '-';
+    int exp = 0;
+    for (p += 2; p != sciEnd; ++p) {
+        exp = exp * 10 + (*p - '0');
+    }
+    const int kk = (negExp ? -exp : exp) + 1; // 10^(kk-1) <= v < 10^kk
+    const int k = kk - len;
+    if (k >= 0 && kk <= 21) {
+        // 1234e7 -> 12340000000.0
+        ::memcpy(out, digits, size_t(len));
+        ::memset(out + len, '0', size_t(k));
+        out += kk;
+        *out++ = '.';
+        *out++ = '0';
+    } else if (kk > 0 && kk <= 21) {
+        // 1234e-2 -> 12.34
+        ::memcpy(out, digits, size_t(kk));
+        out[kk] = '.';
+        ::memcpy(out + kk + 1, digits + kk, size_t(len - kk));
+        out += len + 1;
+    } else if (kk > -6 && kk <= 0) {
+        // 1234e-6 -> 0.001234
+        *out++ = '0';
+        *out++ = '.';
+        ::memset(out, '0', size_t(-kk));
+        out += -kk;
+        ::memcpy(out, digits, size_t(len));
+        out += len;
+    } else {
+        // 1e30, 1234e30 -> 1.234e33
+        *out++ = digits[0];
+        if (len > 1) {
+            *out++ = '.';
+            ::memcpy(out, digits + 1, size_t(len - 1));
+            out += len - 1;
+        }
+        *out++ = 'e';
+        out = std::to_chars(out, out + 8, kk - 1).ptr;
+    }
+    return out;
+}
 
-constexpr auto wrFlags = kWriteNanAndInfNullFlag;
+//! Writes tokens straight into buffer of membuff::Out. Space is reserved in advance for each
+//! token (so no per-byte checks), strings are scanned for special chars 16 bytes at a time.
+//! If unchecked, buffer is known to be big enough (see JsonSizeBound()) and is never grown
+template<bool unchecked = false>
+struct TokenWriter {
+    //! Enough for any number, literal or escape sequence
+    static constexpr size_t maxToken = 64;
 
-using Pretty = PrettyWriter<Stream, UTF8<>, UTF8<>, RapidArenaAllocator, wrFlags>;
-using Basic = Writer<Stream, UTF8<>, UTF8<>, RapidArenaAllocator, wrFlags>;
+    membuff::Out& out;
+    char* cur;
+    char* end;
 
-template<typename Target>
-struct Override : public Target {
-    using Target::Target;
-    void DoRawNumber(const char* beg, const char* end) {
-        if constexpr (std::is_same_v<Target, Pretty>) {
-            this->PrettyPrefix(kNumberType);
+    explicit TokenWriter(membuff::Out& out) noexcept : out(out) {
+        load();
+    }
+
+    void load() noexcept {
+        cur = out.buffer + out.ptr;
+        end = unchecked ? cur : out.buffer + out.capacity;
+    }
+    void commit() noexcept {
+        out.ptr = size_t(cur - out.buffer);
+    }
+    meta_alwaysInline void reserve(size_t n) {
+        if constexpr (unchecked) {
+            return;
+        }
+        if (meta_Unlikely(size_t(end - cur) < n)) {
+            grow(n);
+        }
+    }
+    meta_noInline void grow(size_t n) {
+        commit();
+        do {
+            out.Grow((std::max)(n, out.capacity));
+            if (meta_Unlikely(out.LastError)) {
+                throw std::runtime_error("DumpJson: could not write output");
+            }
+        } while (out.capacity - out.ptr < n);
+        load();
+    }
+    void raw(const char* data, size_t size) {
+        if (unchecked || meta_Likely(size_t(end - cur) >= size)) {
+            if (size) ::memcpy(cur, data, size);
+            cur += size;
         } else {
-            this->Prefix(kNumberType);
+            commit();
+            out.Write(data, size);
+            if (meta_Unlikely(out.LastError)) {
+                throw std::runtime_error("DumpJson: could not write output");
+            }
+            load();
         }
-        this->os_->out.Write(beg, end - beg);
+    }
+    meta_alwaysInline void put(char ch) {
+        reserve(1);
+        *cur++ = ch;
+    }
+    void fill(char ch, size_t count) {
+        while (count) {
+            auto part = (std::min)(count, maxToken);
+            reserve(part);
+            ::memset(cur, ch, part);
+            cur += part;
+            count -= part;
+        }
+    }
+    void string(string_view str) {
+        auto p = str.data();
+        auto e = p + str.size();
+        if (unchecked || meta_Likely(size_t(end - cur) >= str.size() + 2)) {
+            // common case: whole string fits, only escapes need checks
+            *cur++ = '"';
+            for (;;) {
+                auto special = findStringSpecial(p, e);
+                auto clean = size_t(special - p);
+                if (clean) ::memcpy(cur, p, clean);
+                cur += clean;
+                if (special == e) break;
+                escape(*special);
+                p = special + 1;
+                if (!unchecked && meta_Unlikely(size_t(end - cur) < size_t(e - p) + 1)) {
+                    return stringSlow(p, e);
+                }
+            }
+            *cur++ = '"';
+            return;
+        }
+        put('"');
+        stringSlow(p, e);
+    }
+    void stringSlow(const char* p, const char* e) {
+        for (;;) {
+            auto special = findStringSpecial(p, e);
+            raw(p, size_t(special - p));
+            if (special == e) break;
+            escape(*special);
+            p = special + 1;
+        }
+        put('"');
+    }
+    void escape(char ch) {
+        static constexpr char hex[] = "0123456789ABCDEF";
+        reserve(6);
+        *cur++ = '\\';
+        switch (ch) {
+        case '"': *cur++ = '"'; break;
+        case '\\': *cur++ = '\\'; break;
+        case '\b': *cur++ = 'b'; break;
+        case '\f': *cur++ = 'f'; break;
+        case '\n': *cur++ = 'n'; break;
+        case '\r': *cur++ = 'r'; break;
+        case '\t': *cur++ = 't'; break;
+        default: {
+            *cur++ = 'u';
+            *cur++ = '0';
+            *cur++ = '0';
+            *cur++ = hex[uint8_t(ch) >> 4];
+            *cur++ = hex[uint8_t(ch) & 0xF];
+        }
+        }
+    }
+    //! Base64 string: whole groups which fit into buffer are encoded at once,
+    //! so padding may only appear at the end
+    void binary(string_view data) {
+        if constexpr (unchecked) {
+            *cur++ = '"';
+            cur = EncodeBase64(cur, data);
+            *cur++ = '"';
+            return;
+        }
+        put('"');
+        while (!data.empty()) {
+            reserve(maxToken);
+            auto part = (std::min)(data.size(), size_t(end - cur) / 4 * 3);
+            cur = EncodeBase64(cur, data.substr(0, part));
+            data.remove_prefix(part);
+        }
+        put('"');
+    }
+    void number(string_view text) {
+        raw(text.data(), text.size());
+    }
+    template<typename T>
+    void integer(T v) {
+        reserve(maxToken);
+        cur = std::to_chars(cur, cur + maxToken, v).ptr;
+    }
+    void real(double v) {
+        reserve(maxToken);
+        cur = writeDouble(cur, v);
+    }
+    void literal(string_view lit) {
+        reserve(maxToken);
+        ::memcpy(cur, lit.data(), lit.size());
+        cur += lit.size();
     }
 };
 
-template<typename Writer>
-static void visit(JsonView json, unsigned depth, Writer& wr) {
-    DepthError::Check(depth--);
-    switch (json.GetType()) {
-    case t_array: {
-        wr.StartArray();
-        for (auto i: json.Array(false)) {
-            visit(i, depth, wr);
-        }
-        wr.EndArray(json.GetUnsafe().size);
-        break;
-    }
-    case t_object:{
-        wr.StartObject();
-        for (auto [key, v]: json.Object(false)) {
-            assert(!key.empty());
-            wr.Key(key.data(), key.size(), false);
-            visit(v, depth, wr);
-        }
-        wr.EndObject(json.GetUnsafe().size);
-        break;
-    }
-    case t_number: {
-        wr.Double(json.GetUnsafe().d.number);
-        break;
-    }
-    case t_signed: {
-        char buff[50];
-        auto [ptr, ec] = std::to_chars(std::begin(buff), std::end(buff), json.GetUnsafe().d.integer);
-        wr.DoRawNumber(buff, ptr);
-        break;
-    }
-    case t_unsigned: {
-        char buff[50];
-        auto [ptr, ec] = std::to_chars(std::begin(buff), std::end(buff), json.GetUnsafe().d.uinteger);
-        wr.DoRawNumber(buff, ptr);
-        break;
-    }
-    case t_null: {
-        wr.Null();
-        break;
-    }
-    case t_string: {
-        auto str = json.GetStringUnsafe();
-        if (auto s = str.data()) {
-            wr.String(s, str.size());
+//! Whole DOM is walked with explicit stack
+template<bool pretty, bool unchecked = false>
+struct Writer : TokenWriter<unchecked> {
+    using Base = TokenWriter<unchecked>;
+    using Base::cur;
+    using Base::reserve;
+    using Base::put;
+    using Base::fill;
+    using Base::raw;
+    using Base::string;
+    using Base::binary;
+    using Base::number;
+    using Base::integer;
+    using Base::real;
+    using Base::literal;
+    using Base::commit;
+
+    DumpOptions const& opts;
+
+    struct Frame {
+        union {
+            const JsonView* item;
+            const JsonPair* pair;
+        };
+        unsigned left;
+        bool object;
+        bool empty;
+    };
+    ArenaVector<Frame> stack;
+    Arena& alloc;
+
+    Writer(membuff::Out& out, DumpOptions const& opts, Arena& alloc) :
+        Base(out), opts(opts), stack(alloc), alloc(alloc)
+    {
+        stack.reserve(32);
+    }
+
+    void newline() {
+        put('\n');
+        fill(opts.indentChar, stack.size() * opts.indent);
+    }
+    void open(char bracket, const void* items, unsigned size, bool object) {
+        put(bracket);
+        Frame f;
+        if (object) {
+            f.pair = static_cast<const JsonPair*>(items);
         } else {
-            wr.String("", 0);
+            f.item = static_cast<const JsonView*>(items);
         }
-        break;
+        f.left = size;
+        f.object = object;
+        f.empty = true;
+        stack.push_back(f);
     }
-    case t_boolean: {
-        wr.Bool(json.GetUnsafe().d.boolean);
-        break;
+    //! Scalars are written at once, containers are pushed to stack
+    void value(JsonView json) {
+        DepthError::Check(opts.maxDepth - unsigned(stack.size()));
+        auto& data = json.GetUnsafe();
+        switch (json.GetType()) {
+        case t_array: {
+            open('[', data.d.array, data.size, false);
+            break;
+        }
+        case t_object: {
+            open('{', data.d.object, data.size, true);
+            break;
+        }
+        case t_number: {
+            if (json.HasFlag(f_lazy_number)) {
+                number(json.GetNumberText());
+            } else {
+                real(data.d.number);
+            }
+            break;
+        }
+        case t_signed: {
+            if (json.HasFlag(f_lazy_number)) {
+                number(json.GetNumberText());
+            } else {
+                integer(data.d.integer);
+            }
+            break;
+        }
+        case t_unsigned: {
+            if (json.HasFlag(f_lazy_number)) {
+                number(json.GetNumberText());
+            } else {
+                integer(data.d.uinteger);
+            }
+            break;
+        }
+        case t_string: {
+            string(json.GetStringUnsafe());
+            break;
+        }
+        case t_binary: {
+            binary(json.GetBinaryUnsafe());
+            break;
+        }
+        case t_boolean: {
+            literal(data.d.boolean ? "true"sv : "false"sv);
+            break;
+        }
+        case t_raw: {
+            // spliced as is, unless reformatting is needed
+            if (!pretty && json.GetRawFormat() == RawFormat::json) {
+                auto fragment = json.GetRaw();
+                raw(fragment.data(), fragment.size());
+                break;
+            }
+            // kept in alloc until the whole dump is done: frames may reference it
+            value(Materialize(json, alloc));
+            break;
+        }
+        default: {
+            literal("null"sv);
+            break;
+        }
+        }
     }
-    default: {
-        break;
+    void Dump(JsonView json) {
+        value(json);
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            if (!top.left) {
+                bool object = top.object;
+                bool empty = top.empty;
+                stack.pop_back();
+                if (pretty && !empty) {
+                    newline();
+                }
+                put(object ? '}' : ']');
+                continue;
+            }
+            top.left--;
+            if (!top.empty) {
+                put(',');
+            }
+            top.empty = false;
+            if (pretty) {
+                newline();
+            }
+            if (top.object) {
+                auto& pair = *top.pair++;
+                assert(!pair.key.empty());
+                string(pair.key);
+                if (pretty) {
+                    reserve(2);
+                    *cur++ = ':';
+                    *cur++ = ' ';
+                } else {
+                    put(':');
+                }
+                value(pair.value);
+            } else {
+                value(*top.item++);
+            }
+        }
+        commit();
     }
+};
+
+
+//! Same walk as in Writer, but only sizes are summed
+struct SizeBound {
+    //! Longest double: '-0.0000012345678901234567'
+    static constexpr size_t maxDouble = 25;
+
+    DumpOptions const& opts;
+    Arena& alloc;
+    bool pretty;
+    size_t size = 0;
+
+    struct Frame {
+        JsonView container;
+        unsigned idx;
+    };
+    ArenaVector<Frame> stack;
+
+    SizeBound(DumpOptions const& opts, Arena& alloc) :
+        opts(opts), alloc(alloc), pretty(opts.pretty), stack(alloc)
+    {
+        stack.reserve(32);
     }
-}
 
+    void string(string_view str) noexcept {
+        size += str.size() + 2;
+        auto p = str.data();
+        auto e = p + str.size();
+        while ((p = findStringSpecial(p, e)) != e) {
+            switch (*p++) {
+            case '"': case '\\': case '\b': case '\f': case '\n': case '\r': case '\t':
+                size += 1;
+                break;
+            default:
+                size += 5;
+            }
+        }
+    }
+    void newline() noexcept {
+        size += 1 + stack.size() * opts.indent;
+    }
+    void value(JsonView json) {
+        DepthError::Check(opts.maxDepth - unsigned(stack.size()));
+        auto& data = json.GetUnsafe();
+        switch (json.GetType()) {
+        case t_array:
+        case t_object: {
+            size += 2;
+            stack.push_back({json, 0});
+            break;
+        }
+        case t_number: {
+            size += json.HasFlag(f_lazy_number) ? json.GetNumberText().size() : maxDouble;
+            break;
+        }
+        case t_signed:
+        case t_unsigned: {
+            if (json.HasFlag(f_lazy_number)) {
+                size += json.GetNumberText().size();
+                break;
+            }
+            char buff[24];
+            auto res = json.GetType() == t_signed
+                           ? std::to_chars(buff, std::end(buff), data.d.integer)
+                           : std::to_chars(buff, std::end(buff), data.d.uinteger);
+            size += size_t(res.ptr - buff);
+            break;
+        }
+        case t_string: {
+            string(json.GetStringUnsafe());
+            break;
+        }
+        case t_binary: {
+            size += Base64Size(data.size) + 2;
+            break;
+        }
+        case t_boolean: {
+            size += data.d.boolean ? 4 : 5;
+            break;
+        }
+        case t_raw: {
+            if (!pretty && json.GetRawFormat() == RawFormat::json) {
+                size += json.GetRaw().size();
+                break;
+            }
+            value(Materialize(json, alloc));
+            break;
+        }
+        default: {
+            size += 4;
+            break;
+        }
+        }
+    }
+    size_t Count(JsonView json) {
+        value(json);
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            auto& data = top.container.GetUnsafe();
+            if (top.idx == data.size) {
+                stack.pop_back();
+                if (pretty && data.size) {
+                    newline();
+                }
+                continue;
+            }
+            auto idx = top.idx++;
+            size += idx != 0;
+            if (pretty) {
+                newline();
+            }
+            if (top.container.Is(t_object)) {
+                auto& pair = data.d.object[idx];
+                string(pair.key);
+                size += pretty ? 2 : 1;
+                value(pair.value);
+            } else {
+                value(data.d.array[idx]);
+            }
+        }
+        return size;
+    }
+};
+
+struct FixedOut final : membuff::Out {
+    FixedOut(char* buff) {
+        buffer = buff;
+    }
+    void Grow(size_t) override {
+        LastError = 1;
+    }
+};
 }
 
 void jv::DumpJsonInto(membuff::Out &out, JsonView json, DumpOptions opts)
 {
-    Stream stream{out};
     DefaultArena arena;
-    RapidArenaAllocator alloc{&arena};
     if (opts.pretty) {
-        Override<Pretty> writer(stream, &alloc, 32);
-        writer.SetIndent(opts.indentChar, opts.indent);
-        visit(json, opts.maxDepth, writer);
+        Writer<true>(out, opts, arena).Dump(json);
     } else {
-        Override<Basic> writer(stream, &alloc);
-        visit(json, opts.maxDepth, writer);
+        Writer<false>(out, opts, arena).Dump(json);
     }
 }
+
+size_t jv::JsonSizeBound(JsonView json, DumpOptions opts)
+{
+    DefaultArena arena;
+    return SizeBound(opts, arena).Count(json);
+}
+
+char* jv::DumpJsonTo(char* buffer, JsonView json, DumpOptions opts)
+{
+    FixedOut out(buffer);
+    DefaultArena arena;
+    if (opts.pretty) {
+        Writer<true, true>(out, opts, arena).Dump(json);
+    } else {
+        Writer<false, true>(out, opts, arena).Dump(json);
+    }
+    return out.Current();
+}
+
+void detail::JsonEncoder::Null()
+{
+    TokenWriter<> w(out);
+    w.literal("null"sv);
+    w.commit();
+}
+
+void detail::JsonEncoder::Bool(bool v)
+{
+    TokenWriter<> w(out);
+    w.literal(v ? "true"sv : "false"sv);
+    w.commit();
+}
+
+void detail::JsonEncoder::Int(int64_t v)
+{
+    TokenWriter<> w(out);
+    w.integer(v);
+    w.commit();
+}
+
+void detail::JsonEncoder::UInt(uint64_t v)
+{
+    TokenWriter<> w(out);
+    w.integer(v);
+    w.commit();
+}
+
+void detail::JsonEncoder::Double(double v)
+{
+    TokenWriter<> w(out);
+    w.real(v);
+    w.commit();
+}
+
+void detail::JsonEncoder::String(string_view v)
+{
+    TokenWriter<> w(out);
+    w.string(v);
+    w.commit();
+}
+
+void detail::JsonEncoder::Binary(string_view v)
+{
+    TokenWriter<> w(out);
+    w.binary(v);
+    w.commit();
+}
+
+void detail::JsonEncoder::Value(JsonView json, unsigned depth, bool)
+{
+    DumpOptions opts;
+    opts.maxDepth = depth;
+    DumpJsonInto(out, json, opts);
+}
+
+void detail::JsonEncoder::Doubles(const double* data, unsigned size)
+{
+    TokenWriter<> w(out);
+    for (unsigned i = 0; i < size; ++i) {
+        if (i) {
+            w.put(',');
+        }
+        w.real(data[i]);
+    }
+    w.commit();
+}
+
+void detail::JsonEncoder::StartArray(unsigned)
+{
+    TokenWriter<> w(out);
+    w.put('[');
+    w.commit();
+}
+
+void detail::JsonEncoder::Item(unsigned idx)
+{
+    if (idx) {
+        TokenWriter<> w(out);
+        w.put(',');
+        w.commit();
+    }
+}
+
+void detail::JsonEncoder::EndArray()
+{
+    TokenWriter<> w(out);
+    w.put(']');
+    w.commit();
+}
+
+void detail::JsonEncoder::StartObject(unsigned)
+{
+    TokenWriter<> w(out);
+    w.put('{');
+    w.commit();
+}
+
+void detail::JsonEncoder::Key(unsigned idx, string_view key)
+{
+    TokenWriter<> w(out);
+    if (idx) {
+        w.put(',');
+    }
+    w.string(key);
+    w.put(':');
+    w.commit();
+}
+
+void detail::JsonEncoder::EndObject()
+{
+    TokenWriter<> w(out);
+    w.put('}');
+    w.commit();
+}
@@ -24,6 +24,7 @@ SOFTWARE.
 
 #define NOMINMAX
 #include "json_view/dump.hpp"
+#include "json_view/parse.hpp"
 #include "endian.hpp"
 
 using namespace jv;
@@ -54,24 +55,57 @@ static auto toBig(const T& raw) noexcept
 }
 }
 
-static void writeType(uint8_t what, membuff::Out &out) {
+//! Unchecked output into buffer of MsgPackSize() bytes
+struct RawOut {
+    char* ptr;
+    void Write(const void* data, size_t size) noexcept {
+        if (size) ::memcpy(ptr, data, size);
+        ptr += size;
+    }
+    void Write(uint8_t byte) noexcept {
+        *ptr++ = char(byte);
+    }
+    void WriteRef(const char* data, size_t size) noexcept {
+        Write(data, size);
+    }
+};
+
+//! Same encoding, but only its size is counted
+struct SizeOut {
+    size_t size = 0;
+    void Write(const void*, size_t sz) noexcept {
+        size += sz;
+    }
+    void Write(uint8_t) noexcept {
+        size++;
+    }
+    void WriteRef(const char*, size_t sz) noexcept {
+        size += sz;
+    }
+};
+
+template<typename Out>
+static void writeType(uint8_t what, Out &out) {
     out.Write(what);
 }
 
+template<typename Out>
 [[maybe_unused]]
-static void write(std::string_view what, membuff::Out &out){
-    out.Write(what);
+static void write(std::string_view what, Out &out){
+    // payloads: may be referenced by output instead of copying
+    out.WriteRef(what.data(), what.size());
 }
 
-template<typename T>
-static void write(T what, membuff::Out &out){
+template<typename T, typename Out>
+static void write(T what, Out &out){
     auto temp = toBig(what);
     out.Write(temp.data(), temp.size());
 };
 
 using std::numeric_limits;
 
-static inline void writeString(string_view sv, membuff::Out &out)
+template<typename Out>
+static inline void writeString(string_view sv, Out &out)
 {
     if (sv.size() <= 0b11111) {
         writeType(uint8_t(0b10100000 | sv.size()), out);
@@ -85,10 +119,27 @@ static inline void writeString(string_view sv, membuff::Out &out)
         writeType(0xdb, out);
         write(uint32_t(sv.size()), out);
     }
-    out.Write(sv);
+    write(sv, out);
+}
+
+template<typename Out>
+static inline void writeBinary(string_view bin, Out &out)
+{
+    if (bin.size() <= numeric_limits<uint8_t>::max()) {
+        writeType(0xc4, out);
+        write(uint8_t(bin.size()), out);
+    } else if (bin.size() <= numeric_limits<uint16_t>::max()) {
+        writeType(0xc5, out);
+        write(uint16_t(bin.size()), out);
+    } else {
+        writeType(0xc6, out);
+        write(uint32_t(bin.size()), out);
+    }
+    write(bin, out);
 }
 
-static inline void writeNegInt(int64_t i, membuff::Out& out) {
+template<typename Out>
+static inline void writeNegInt(int64_t i, Out& out) {
     if (i >= -32) {
         writeType(int8_t(i), out);
     } else if (i >= numeric_limits<int8_t>::min()) {
@@ -106,7 +157,8 @@ static inline void writeNegInt(int64_t i, membuff::Out& out) {
     }
 }
 
-static inline void writePosInt(uint64_t i, membuff::Out& out) {
+template<typename Out>
+static inline void writePosInt(uint64_t i, Out& out) {
     if (i < 128) {
         writeType(uint8_t(i), out);
     } else if (i <= numeric_limits<uint8_t>::max()) {
@@ -124,47 +176,149 @@ static inline void writePosInt(uint64_t i, membuff::Out& out) {
     }
 }
 
+template<typename Out>
+static inline void writeArrayHeader(unsigned sz, Out& out) {
+    if (sz <= 0b1111) {
+        writeType(uint8_t(0b10010000 | sz), out);
+    } else if (sz <= numeric_limits<uint16_t>::max()) {
+        writeType(0xdc, out);
+        write(uint16_t(sz), out);
+    } else {
+        writeType(0xdd, out);
+        write(uint32_t(sz), out);
+    }
+}
+
+template<typename Out>
+static inline void writeMapHeader(unsigned sz, Out& out) {
+    if (sz <= 0b1111)  {
+        writeType(uint8_t(0b10000000 | sz), out);
+    } else if (sz <= numeric_limits<uint16_t>::max()) {
+        writeType(0xde, out);
+        write(uint16_t(sz), out);
+    } else {
+        writeType(0xdf, out);
+        write(uint32_t(sz), out);
+    }
+}
+
 #if !defined(__clang__) && !defined(_WIN32)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wuseless-cast"
 #endif
 
-void jv::DumpMsgPackInto(membuff::Out &out, JsonView json, DumpOptions opts)
+//! Doubles (e.g. telemetry arrays) are written without per item dispatch,
+//! into membuff::Out directly by as many items as its buffer fits
+template<typename Out, typename Get>
+static void writeDoubles(Out &out, unsigned count, Get get) {
+    unsigned i = 0;
+    if constexpr (std::is_same_v<Out, membuff::Out>) {
+        constexpr size_t each = 1 + sizeof(double);
+        while (i < count) {
+            auto fit = unsigned((std::min)(size_t(count - i), (out.capacity - out.ptr) / each));
+            if (!fit) {
+                out.Grow((std::max)((count - i) * each, out.capacity));
+                if (meta_Unlikely(out.LastError) || out.capacity - out.ptr < each) {
+                    break;
+                }
+                continue;
+            }
+            auto cur = out.buffer + out.ptr;
+            for (auto end = i + fit; i < end; ++i) {
+                auto temp = toBig(get(i));
+                cur[0] = char(0xcb);
+                ::memcpy(cur + 1, temp.data(), sizeof(double));
+                cur += each;
+            }
+            out.ptr += fit * each;
+        }
+    }
+    for (; i < count; ++i) {
+        writeType(uint8_t(0xcb), out);
+        write(get(i), out);
+    }
+}
+
+//! Returns count of plain doubles written from start of items
+template<typename Out>
+static unsigned writeDoubleItems(Out &out, const JsonView* items, unsigned size) {
+    unsigned count = 0;
+    while (count < size && items[count].GetUnsafe().type == t_number && !items[count].GetUnsafe().flags) {
+        count++;
+    }
+    writeDoubles(out, count, [items](unsigned i) {
+        return items[i].GetUnsafe().d.number;
+    });
+    return count;
+}
+
+template<typename Out>
+static void dump(Out &out, JsonView json, DumpOptions opts);
+
+//! Values in temporary arena must be copied: output may be kept longer than it (see Out::WriteRef())
+struct CopyScope {
+    template<typename Out>
+    explicit CopyScope(Out& out) noexcept {
+        if constexpr (std::is_same_v<Out, membuff::Out>) {
+            target = &out;
+            saved = std::exchange(out.refThreshold, 0);
+        }
+    }
+    CopyScope(CopyScope const&) = delete;
+    CopyScope& operator=(CopyScope const&) = delete;
+    ~CopyScope() {
+        if (target) {
+            target->refThreshold = saved;
+        }
+    }
+private:
+    membuff::Out* target = nullptr;
+    size_t saved = 0;
+};
+
+//! Kept out of dump(): arena on stack would make each level of recursion heavier
+template<typename Out>
+meta_noInline static void dumpMaterialized(Out &out, JsonView json, DumpOptions opts)
+{
+    DefaultArena alloc;
+    CopyScope copy(out);
+    dump(out, Materialize(json, alloc), opts);
+}
+
+template<typename Out>
+static void dump(Out &out, JsonView json, DumpOptions opts)
 {
     DepthError::Check(opts.maxDepth);
+    if (meta_Unlikely(json.HasFlag(f_lazy_number))) {
+        json = json.ParsedNumber();
+    }
     switch (json.GetType()) {
     case t_array: {
-        auto sz = json.GetUnsafe().size;
-        if (sz <= 0b1111) {
-            writeType(uint8_t(0b10010000 | sz), out);
-        } else if (sz <= numeric_limits<uint16_t>::max()) {
-            writeType(0xdc, out);
-            write(uint16_t(sz), out);
-        } else {
-            writeType(0xdd, out);
-            write(uint32_t(sz), out);
-        }
+        writeArrayHeader(json.GetUnsafe().size, out);
         opts.maxDepth--;
-        for (auto v: json.Array()) {
-            DumpMsgPackInto(out, v, opts);
+        auto items = json.GetUnsafe().d.array;
+        auto size = json.GetUnsafe().size;
+        if (size) {
+            // items are checked here: runs of doubles skip dump()
+            DepthError::Check(opts.maxDepth);
+        }
+        for (unsigned i = 0; i < size;) {
+            if (items[i].GetUnsafe().type == t_number) {
+                if (auto written = writeDoubleItems(out, items + i, size - i)) {
+                    i += written;
+                    continue;
+                }
+            }
+            dump(out, items[i++], opts);
         }
         break;
     }
     case t_object: {
-        auto sz = json.GetUnsafe().size;
-        if (sz <= 0b1111)  {
-            writeType(uint8_t(0b10000000 | sz), out);
-        } else if (sz <= numeric_limits<uint16_t>::max()) {
-            writeType(0xde, out);
-            write(uint16_t(sz), out);
-        } else {
-            writeType(0xdf, out);
-            write(uint32_t(sz), out);
-        }
+        writeMapHeader(json.GetUnsafe().size, out);
         opts.maxDepth--;
         for (auto [k, v]: json.Object()) {
             writeString(k, out);
-            DumpMsgPackInto(out, v, opts);
+            dump(out, v, opts);
         }
         break;
     }
@@ -192,26 +346,21 @@ void jv::DumpMsgPackInto(membuff::Out &out, JsonView json, DumpOptions opts)
         break;
     }
     case t_binary: {
-        auto bin = json.GetUnsafe().d.binary;
-        auto sz = json.GetUnsafe().size;
-        if (sz <= numeric_limits<uint8_t>::max()) {
-            writeType(0xc4, out);
-            write(uint8_t(sz), out);
-        } else if (sz <= numeric_limits<uint16_t>::max()) {
-            writeType(0xc5, out);
-            write(uint16_t(sz), out);
-        } else {
-            writeType(0xc6, out);
-            write(uint32_t(sz), out);
-        }
-        auto sv = std::string_view{reinterpret_cast<const char*>(bin), sz};
-        write(sv, out);
+        writeBinary(json.GetBinaryUnsafe(), out);
         break;
     }
     case t_string: {
         writeString(json.GetStringUnsafe(), out);
         break;
     }
+    case t_raw: {
+        if (json.GetRawFormat() == RawFormat::msgpack) {
+            write(json.GetRaw(), out);
+        } else {
+            dumpMaterialized(out, json, opts);
+        }
+        break;
+    }
     default: {
         break;
     }
@@ -221,3 +370,91 @@ void jv::DumpMsgPackInto(membuff::Out &out, JsonView json, DumpOptions opts)
 #if !defined(__clang__) && !defined(_WIN32)
 #pragma GCC diagnostic pop
 #endif
+
+void jv::DumpMsgPackInto(membuff::Out &out, JsonView json, DumpOptions opts)
+{
+    dump(out, json, opts);
+}
+
+size_t jv::MsgPackSize(JsonView json, DumpOptions opts)
+{
+    SizeOut out;
+    dump(out, json, opts);
+    return out.size;
+}
+
+char* jv::DumpMsgPackTo(char* buffer, JsonView json, DumpOptions opts)
+{
+    RawOut out{buffer};
+    dump(out, json, opts);
+    return out.ptr;
+}
+
+void detail::MsgPackEncoder::Null()
+{
+    writeType(uint8_t(0xc0), out);
+}
+
+void detail::MsgPackEncoder::Bool(bool v)
+{
+    writeType(v ? uint8_t(0xc3) : uint8_t(0xc2), out);
+}
+
+void detail::MsgPackEncoder::Int(int64_t v)
+{
+    if (v < 0) {
+        writeNegInt(v, out);
+    } else {
+        writePosInt(uint64_t(v), out);
+    }
+}
+
+void detail::MsgPackEncoder::UInt(uint64_t v)
+{
+    writePosInt(v, out);
+}
+
+void detail::MsgPackEncoder::Double(double v)
+{
+    writeType(uint8_t(0xcb), out);
+    write(v, out);
+}
+
+void detail::MsgPackEncoder::String(string_view v)
+{
+    writeString(v, out);
+}
+
+void detail::MsgPackEncoder::Binary(string_view v)
+{
+    writeBinary(v, out);
+}
+
+void detail::MsgPackEncoder::Value(JsonView json, unsigned depth, bool temporary)
+{
+    DumpOptions opts;
+    opts.maxDepth = depth;
+    if (temporary) {
+        CopyScope copy(out);
+        dump(out, json, opts);
+    } else {
+        dump(out, json, opts);
+    }
+}
+
+void detail::MsgPackEncoder::Doubles(const double* data, unsigned size)
+{
+    writeDoubles(out, size, [data](unsigned i) {
+        return data[i];
+    });
+}
+
+void detail::MsgPackEncoder::StartArray(unsigned size)
+{
+    writeArrayHeader(size, out);
+}
+
+void detail::MsgPackEncoder::StartObject(unsigned size)
+{
+    writeMapHeader(size, out);
+}
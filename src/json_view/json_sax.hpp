@@ -0,0 +1,489 @@
+// This file is a part of RPCXX project
+
+/*
+Copyright 2024 "NEOLANT Service", "NEOLANT Kalinigrad", Alexey Doronin, Anastasia Lugovets, Dmitriy Dyakonov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include "json_view/algo.hpp"
+#include "json_view/parse.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JV_SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JV_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace jv::detail {
+
+//! Two-stage parser (structural index + DOM builder). If inPlace, buff is owned by parser
+//! and escaped strings are decoded in it, otherwise buff is not modified and only they are copied.
+//! Returns false if input cannot be handled by it (comments, >4GB), generic backend should be used then
+bool ParseJsonSimd(const char* buff, size_t len, bool inPlace, Arena& alloc, ParseSettings const& opts, JsonView& out);
+
+}
+
+namespace {
+
+using namespace jv;
+
+//! Heap by default. Arena is given if scratch is a part of parser state (see JsonStreamParser):
+//! its memory is counted by Arena::Stats() and limited by DefaultArena::SetLimit() then
+template<typename T>
+struct scratch_allocator {
+    Arena* a = nullptr;
+    using value_type = T;
+    scratch_allocator() noexcept = default;
+    explicit scratch_allocator(Arena* alloc) noexcept : a(alloc) {}
+    template<typename U>
+    scratch_allocator(scratch_allocator<U> const& other) noexcept : a(other.a) {}
+    T* allocate(size_t n) {
+        if (a) {
+            return static_cast<T*>(a->Allocate(sizeof(T) * n, alignof(T)));
+        }
+        return std::allocator<T>{}.allocate(n);
+    }
+    void deallocate(T* p, size_t n) noexcept {
+        if (!a) {
+            std::allocator<T>{}.deallocate(p, n);
+        }
+    }
+    template<typename U>
+    bool operator==(scratch_allocator<U> const& other) const noexcept {
+        return a == other.a;
+    }
+    template<typename U>
+    bool operator!=(scratch_allocator<U> const& other) const noexcept {
+        return a != other.a;
+    }
+};
+
+//! Elements of containers, which are not yet closed. Reused between parses
+struct SaxScratch {
+    std::vector<JsonView, scratch_allocator<JsonView>> values;
+    std::vector<JsonPair, scratch_allocator<JsonPair>> pairs;
+
+    SaxScratch() = default;
+    explicit SaxScratch(Arena& alloc) :
+        values(scratch_allocator<JsonView>(&alloc)),
+        pairs(scratch_allocator<JsonPair>(&alloc))
+    {}
+
+    void Clear() noexcept {
+        values.clear();
+        pairs.clear();
+    }
+    //! Do not hold on to memory after huge documents
+    void Trim() noexcept {
+        constexpr size_t keep = 1 << 16;
+        if (values.capacity() > keep) {
+            values = {};
+        }
+        if (pairs.capacity() > keep) {
+            pairs = {};
+        }
+    }
+    static SaxScratch& ThreadLocal() {
+        static thread_local SaxScratch scratch;
+        return scratch;
+    }
+};
+
+//! Builds JsonView tree from SAX-like events. Shared by all json backends.
+//! Elements are collected on scratch stack and containers are copied into Arena once closed
+struct SaxHandler
+{
+    typedef char Ch;
+    enum Tag {
+        val,
+        arr,
+        obj,
+    };
+    Arena& alloc;
+    ParseSettings opts;
+    SaxScratch& scratch;
+    struct State {
+        size_t start;
+        string_view key;
+        Tag tag = val;
+    };
+    ArenaVector<State> stack = ArenaVector<State>(alloc);
+    JsonView result = {};
+    State current = {};
+    //! Set if RawNumber() rejected number
+    const char* numberError = nullptr;
+
+    SaxHandler(Arena& alloc, ParseSettings opts, SaxScratch& scratch = SaxScratch::ThreadLocal()) :
+        alloc(alloc), opts(opts), scratch(scratch)
+    {
+        scratch.Clear();
+    }
+    SaxHandler(SaxHandler const&) = delete;
+    ~SaxHandler() {
+        scratch.Trim();
+    }
+
+    std::true_type doAdd(JsonView view) {
+        if (meta_Unlikely(current.tag == val)) {
+            result = view;
+        } else if (current.tag == obj) {
+            // sorted once in EndObject()
+            scratch.pairs.push_back({current.key, view});
+        } else { //arr
+            assert(current.tag == arr);
+            scratch.values.push_back(view);
+        }
+        return {};
+    }
+
+    //! Value for current key should be kept as t_raw (see ParseSettings::rawKeys)
+    bool WantsRaw() const noexcept {
+        if (current.tag != obj) {
+            return false;
+        }
+        auto depth = stack.size();
+        if (depth != 1 && !(depth == 2 && stack[1].tag == arr)) {
+            return false;
+        }
+        return opts.IsRawKey(current.key);
+    }
+    std::true_type RawValue(string_view raw) {
+        return doAdd(JsonView::Raw(raw));
+    }
+    bool LazyNumbers() const noexcept {
+        return opts.lazyNumbers;
+    }
+    std::true_type LazyNumber(string_view text, Type type) {
+        return doAdd(JsonView::LazyNumber(text, type));
+    }
+    //! Generic backend reports numbers as text only if lazyNumbers are on
+    bool RawNumber(const char* str, unsigned len, bool);
+    void Push() {
+        if (meta_Unlikely(stack.size() == opts.maxDepth)) {
+            throw DepthError{};
+        }
+        stack.push_back(current);
+        current = {};
+    }
+    State Pop() {
+        auto was = current;
+        current = stack.back();
+        stack.pop_back();
+        return was;
+    }
+    std::true_type StartArray() {
+        Push();
+        current.tag = arr;
+        current.start = scratch.values.size();
+        return {};
+    }
+    std::true_type StartObject() {
+        Push();
+        current.tag = obj;
+        current.start = scratch.pairs.size();
+        return {};
+    }
+    std::true_type EndArray(unsigned) {
+        auto was = Pop();
+        assert(was.tag == arr);
+        auto first = scratch.values.data() + was.start;
+        auto size = unsigned(scratch.values.size() - was.start);
+        auto array = MakeArrayOf(size, alloc);
+        if (size) {
+            memcpy(array, first, sizeof(JsonView) * size);
+        }
+        scratch.values.resize(was.start);
+        doAdd(JsonView(array, size));
+        return {};
+    }
+    std::true_type EndObject(unsigned) {
+        auto was = Pop();
+        assert(was.tag == obj);
+        auto first = scratch.pairs.data() + was.start;
+        auto size = SortUniqueJson(first, unsigned(scratch.pairs.size() - was.start));
+        auto object = MakeObjectOf(size, alloc);
+        if (size) {
+            memcpy(object, first, sizeof(JsonPair) * size);
+        }
+        scratch.pairs.resize(was.start);
+        doAdd(JsonView(object, size, JsonView::sorted_tag{}));
+        return {};
+    }
+    std::true_type Null() {
+        return doAdd(nullptr);
+    }
+    std::true_type Bool(bool v) {
+        return doAdd(JsonView(v));
+    }
+    std::true_type String(const Ch* str, unsigned len, bool) {
+        doAdd(string_view{str, len});
+        return {};
+    }
+    std::true_type Key(const Ch* str, unsigned len, bool) {
+        current.key = {str, len};
+        return {};
+    }
+    JsonView Result() const noexcept {
+        return result;
+    }
+
+    std::true_type Int(int v) {
+        doAdd(JsonView(v));
+        return {};
+    }
+    std::true_type Uint(unsigned v) {
+        doAdd(JsonView(v));
+        return {};
+    }
+    std::true_type Int64(int64_t v) {
+        doAdd(JsonView(v));
+        return {};
+    }
+    std::true_type Uint64(uint64_t v) {
+        doAdd(JsonView(v));
+        return {};
+    }
+    std::true_type Double(double v) {
+        doAdd(JsonView(v));
+        return {};
+    }
+};
+
+meta_alwaysInline inline static unsigned ctz64(uint64_t v) noexcept {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long res;
+    _BitScanForward64(&res, v);
+    return unsigned(res);
+#elif defined(_MSC_VER)
+    unsigned res = 0;
+    while (!(v & 1)) {
+        v >>= 1;
+        res++;
+    }
+    return res;
+#else
+    return unsigned(__builtin_ctzll(v));
+#endif
+}
+
+// first '"', '\\' or control char in [p, end)
+meta_alwaysInline inline static const char* findStringSpecial(const char* p, const char* end) noexcept {
+#if JV_SIMD_SSE2
+    const auto quote = _mm_set1_epi8('"');
+    const auto escape = _mm_set1_epi8('\\');
+    const auto control = _mm_set1_epi8(0x1F);
+    while (end - p >= 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        auto special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, escape)),
+            _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+        if (auto mask = unsigned(_mm_movemask_epi8(special))) {
+            return p + ctz64(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p != end && *p != '"' && *p != '\\' && uint8_t(*p) >= 0x20) {
+        ++p;
+    }
+    return p;
+}
+
+[[maybe_unused]]
+static bool parseDouble(const char* beg, const char* end, double& out) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto res = std::from_chars(beg, end, out);
+    if (meta_Likely(res.ec == std::errc{})) {
+        return true;
+    }
+#endif
+    // also handles underflow (to zero) the same way as rapidjson does
+    std::string copy(beg, end);
+    out = std::strtod(copy.c_str(), nullptr);
+    return std::isfinite(out);
+}
+
+inline static bool isDigit(char c) noexcept {
+    return c >= '0' && c <= '9';
+}
+
+inline static int hexValue(char c) noexcept {
+    if (c >= '0' && c <= '9') return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+inline static char* writeUtf8(char* dst, unsigned cp) noexcept {
+    if (cp < 0x80) {
+        *dst++ = char(cp);
+    } else if (cp < 0x800) {
+        *dst++ = char(0xC0 | (cp >> 6));
+        *dst++ = char(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *dst++ = char(0xE0 | (cp >> 12));
+        *dst++ = char(0x80 | ((cp >> 6) & 0x3F));
+        *dst++ = char(0x80 | (cp & 0x3F));
+    } else {
+        *dst++ = char(0xF0 | (cp >> 18));
+        *dst++ = char(0x80 | ((cp >> 12) & 0x3F));
+        *dst++ = char(0x80 | ((cp >> 6) & 0x3F));
+        *dst++ = char(0x80 | (cp & 0x3F));
+    }
+    return dst;
+}
+
+//! Handle whole non-string scalar token: number, literal or NaN/Infinity.
+//! Returns error message (and sets errAt) on failure
+template<typename Handler>
+static const char* emitScalar(Handler& h, const char* p, const char* end, const char*& errAt) {
+    auto is = [&](string_view lit) {
+        return size_t(end - p) == lit.size() && memcmp(p, lit.data(), lit.size()) == 0;
+    };
+    errAt = p;
+    switch (*p) {
+    case 't': if (is("true")) { h.Bool(true); return nullptr; } return "Invalid value.";
+    case 'f': if (is("false")) { h.Bool(false); return nullptr; } return "Invalid value.";
+    case 'n': if (is("null")) { h.Null(); return nullptr; } return "Invalid value.";
+    default: break;
+    }
+    const char* start = p;
+    bool minus = *p == '-';
+    if (minus) {
+        ++p;
+    }
+    if (p != end && (*p == 'N' || *p == 'I')) {
+        auto rest = string_view{p, size_t(end - p)};
+        if (rest == "NaN") {
+            h.Double(std::numeric_limits<double>::quiet_NaN());
+        } else if (rest == "Inf" || rest == "Infinity") {
+            h.Double(minus
+                     ? -std::numeric_limits<double>::infinity()
+                     : std::numeric_limits<double>::infinity());
+        } else {
+            return "Invalid value.";
+        }
+        return nullptr;
+    }
+    const char* digits = p;
+    if (p != end && *p == '0') {
+        ++p;
+    } else if (p != end && isDigit(*p)) {
+        while (p != end && isDigit(*p)) ++p;
+    } else {
+        return "Invalid value.";
+    }
+    bool isDouble = false;
+    if (p != end && *p == '.') {
+        ++p;
+        if (meta_Unlikely(p == end || !isDigit(*p))) {
+            errAt = p;
+            return "Miss fraction part in number.";
+        }
+        while (p != end && isDigit(*p)) ++p;
+        isDouble = true;
+    }
+    const char* exponent = nullptr;
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        if (p != end && (*p == '+' || *p == '-')) {
+            ++p;
+        }
+        if (meta_Unlikely(p == end || !isDigit(*p))) {
+            errAt = p;
+            return "Miss exponent in number.";
+        }
+        exponent = p;
+        while (p != end && isDigit(*p)) ++p;
+        isDouble = true;
+    }
+    if (meta_Unlikely(p != end)) {
+        return "Invalid value.";
+    }
+    if (h.LazyNumbers()) {
+        // only numbers, which are surely in range: overflow must be reported right away
+        bool fits = isDouble
+                        ? p - start <= 64 && !(exponent && p - exponent > 2)
+                        : p - digits <= 18;
+        if (fits) {
+            h.LazyNumber({start, size_t(p - start)}, isDouble ? t_number : minus ? t_signed : t_unsigned);
+            return nullptr;
+        }
+    }
+    if (meta_Likely(!isDouble)) {
+        uint64_t value;
+        auto res = std::from_chars(digits, p, value);
+        if (meta_Likely(res.ec == std::errc{})) {
+            if (!minus) {
+                h.Uint64(value);
+                return nullptr;
+            } else if (value <= uint64_t(1) << 63) {
+                h.Int64(int64_t(~value + 1));
+                return nullptr;
+            }
+        }
+    }
+    double value;
+    if (meta_Unlikely(!parseDouble(start, p, value))) {
+        return "Number too big to be stored in double.";
+    }
+    h.Double(value);
+    return nullptr;
+}
+
+inline bool SaxHandler::RawNumber(const char* str, unsigned len, bool) {
+    const char* errAt;
+    numberError = emitScalar(*this, str, str + len, errAt);
+    return !numberError;
+}
+
+[[maybe_unused]]
+static std::string atOffset(string_view src, size_t offs) {
+    size_t line = 0;
+    size_t col = 0;
+    for (auto ch: src.substr(0, offs)) {
+        if (ch == '\n') {
+            line++;
+            col = 0;
+        } else {
+            col++;
+        }
+    }
+    return " @ line(" + std::to_string(line) + ") col(" + std::to_string(col) + ")";
+}
+
+}
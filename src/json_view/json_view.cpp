@@ -27,6 +27,8 @@ SOFTWARE.
 #include "json_view/json.hpp"
 #include "json_view/pointer.hpp"
 #include "json_view/algo.hpp"
+#include <charconv>
+#include <cstdlib>
 
 using namespace jv;
 using namespace std::string_view_literals;
@@ -55,6 +57,32 @@ std::string JsonView::DumpMsgPack() const
     return jv::DumpMsgPack(*this);
 }
 
+JsonView JsonView::parseNumber() const
+{
+    auto beg = data.d.string;
+    auto end = beg + data.size;
+    auto flags = Flags(data.flags & ~f_lazy_number);
+    if (data.type == t_signed) {
+        int64_t res = 0;
+        std::from_chars(beg, end, res);
+        return JsonView(res).WithFlagsUnsafe(flags);
+    } else if (data.type == t_unsigned) {
+        uint64_t res = 0;
+        std::from_chars(beg, end, res);
+        return JsonView(res).WithFlagsUnsafe(flags);
+    }
+    double res = 0;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    if (meta_Likely(std::from_chars(beg, end, res).ec == std::errc{})) {
+        return JsonView(res).WithFlagsUnsafe(flags);
+    }
+#endif
+    // underflow (to zero) is handled same way as when parsing eagerly
+    std::string copy(beg, end);
+    res = std::strtod(copy.c_str(), nullptr);
+    return JsonView(res).WithFlagsUnsafe(flags);
+}
+
 void JsonView::throwMissmatch(Type wanted, TraceFrame const& frame) const {
     TypeMissmatch exc(frame);
     exc.wanted = wanted;
@@ -0,0 +1,205 @@
+// This file is a part of RPCXX project
+
+/*
+Copyright 2024 "NEOLANT Service", "NEOLANT Kalinigrad", Alexey Doronin, Anastasia Lugovets, Dmitriy Dyakonov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "json_view/parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "split.hpp"
+
+using namespace jv;
+
+struct ParallelParser::Impl {
+    //! result array and everything parsed on calling thread
+    DefaultArena<> main;
+    //! one per thread (calling thread is 0)
+    std::vector<std::unique_ptr<DefaultArena<0>>> arenas;
+    std::vector<std::thread> workers;
+    std::vector<string_view> elements;
+    size_t minSize = 1 << 18;
+
+    std::mutex mut;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::function<void(unsigned)> job;
+    uint64_t generation = 0;
+    unsigned running = 0;
+    bool stop = false;
+
+    explicit Impl(unsigned threads) {
+        if (!threads) {
+            threads = (std::max)(1u, std::thread::hardware_concurrency());
+        }
+        for (auto i = 0u; i < threads; ++i) {
+            arenas.push_back(std::make_unique<DefaultArena<0>>(1 << 16));
+        }
+        for (auto i = 1u; i < threads; ++i) {
+            workers.emplace_back([this, i]{ loop(i); });
+        }
+    }
+
+    ~Impl() {
+        {
+            std::lock_guard lock(mut);
+            stop = true;
+        }
+        wake.notify_all();
+        for (auto& w: workers) {
+            w.join();
+        }
+    }
+
+    void loop(unsigned id) {
+        uint64_t seen = 0;
+        std::unique_lock lock(mut);
+        for (;;) {
+            wake.wait(lock, [&]{ return stop || generation != seen; });
+            if (stop) {
+                return;
+            }
+            seen = generation;
+            lock.unlock();
+            job(id);
+            lock.lock();
+            if (--running == 0) {
+                finished.notify_one();
+            }
+        }
+    }
+
+    //! Runs f(thread) on every thread, including calling one
+    void runAll(std::function<void(unsigned)> f) {
+        {
+            std::lock_guard lock(mut);
+            job = std::move(f);
+            running = unsigned(workers.size());
+            generation++;
+        }
+        wake.notify_all();
+        job(0);
+        std::unique_lock lock(mut);
+        finished.wait(lock, [&]{ return running == 0; });
+    }
+
+    void reset() {
+        main.Clear();
+        for (auto& a: arenas) {
+            a->Clear();
+        }
+        elements.clear();
+    }
+
+    //! Parses elements into result array. Returns false if any of them failed
+    template<typename Parse>
+    bool parseElements(JsonView*& result, Parse parse) {
+        result = MakeArrayOf(unsigned(elements.size()), main);
+        // several chunks per thread: elements may differ in size a lot
+        const size_t chunks = (std::min)(elements.size(), arenas.size() * 8);
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        runAll([&](unsigned thread) {
+            auto& alloc = *arenas[thread];
+            for (;;) {
+                auto chunk = next.fetch_add(1, std::memory_order_relaxed);
+                if (chunk >= chunks || failed.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                auto begin = elements.size() * chunk / chunks;
+                auto end = elements.size() * (chunk + 1) / chunks;
+                try {
+                    for (auto i = begin; i < end; ++i) {
+                        result[i] = parse(elements[i], alloc);
+                    }
+                } catch (...) {
+                    failed = true;
+                    return;
+                }
+            }
+        });
+        return !failed;
+    }
+};
+
+ParallelParser::ParallelParser(unsigned threads) :
+    d(std::make_unique<Impl>(threads))
+{}
+
+ParallelParser::~ParallelParser() = default;
+
+unsigned ParallelParser::Threads() const noexcept {
+    return unsigned(d->arenas.size());
+}
+
+size_t ParallelParser::MinSize() const noexcept {
+    return d->minSize;
+}
+
+void ParallelParser::SetMinSize(size_t bytes) noexcept {
+    d->minSize = bytes;
+}
+
+JsonView ParallelParser::ParseJson(string_view json, ParseSettings params) {
+    d->reset();
+    if (json.size() >= d->minSize && Threads() > 1 && params.maxDepth > 1
+        && detail::SplitJsonArray(json.data(), json.size(), d->elements))
+    {
+        auto inner = params;
+        inner.maxDepth--;
+        JsonView* result;
+        bool ok = d->parseElements(result, [&](string_view element, Arena& alloc) {
+            return ParseJsonInPlace(element, alloc, inner);
+        });
+        if (ok) {
+            return JsonView(result, unsigned(d->elements.size()));
+        }
+        // exact error is reported by normal parse
+        d->reset();
+    }
+    return ParseJsonInPlace(json, d->main, params);
+}
+
+ParseResult ParallelParser::ParseMsgPack(string_view data, ParseSettings params) {
+    d->reset();
+    size_t consumed = 0;
+    if (data.size() >= d->minSize && Threads() > 1 && params.maxDepth > 1
+        && detail::SplitMsgPackArray(data, d->elements, consumed))
+    {
+        auto inner = params;
+        inner.maxDepth--;
+        JsonView* result;
+        bool ok = d->parseElements(result, [&](string_view element, Arena& alloc) {
+            return ParseMsgPackInPlace(element, alloc, inner).result;
+        });
+        if (ok) {
+            return {JsonView(result, unsigned(d->elements.size())), consumed};
+        }
+        d->reset();
+    }
+    return ParseMsgPackInPlace(data, d->main, params);
+}
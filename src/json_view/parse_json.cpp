@@ -32,6 +32,7 @@ SOFTWARE.
 #include "rapidjson/reader.h"
 #include "rapidjson/error/en.h"
 #include "alloc_adapter.hpp"
+#include "json_sax.hpp"
 
 using namespace jv;
 using namespace rapidjson;
@@ -58,162 +59,13 @@ struct rapidjson::StreamTraits<LimitedStream> {
 
 namespace {
 
-struct SaxHandler
-{
-    typedef typename UTF8<>::Ch Ch;
-    enum Tag {
-        val,
-        arr,
-        obj,
-    };
-    Arena& alloc;
-    ParseSettings opts;
-    struct State {
-        union {
-            JsonView* array;
-            JsonPair* object;
-        };
-        unsigned capacity;
-        unsigned size;
-        string_view key;
-        Tag tag = val;
-    };
-    ArenaVector<State> stack = ArenaVector<State>(alloc);
-    JsonView result = {};
-    State current = {};
-
-    void appendToArray(JsonView view) {
-        if (meta_Unlikely(current.size == current.capacity)) {
-            auto newCap = current.capacity ? current.capacity * 2 : 2;
-            auto newArr = MakeArrayOf(newCap, alloc);
-            if (current.array) {
-                memcpy(newArr, current.array, sizeof(JsonView) * current.size);
-            }
-            current.array = newArr;
-            current.capacity = newCap;
-        }
-        current.array[current.size++] = view;
-    }
-
-
-    void appendToObject(JsonView view) {
-        if (meta_Unlikely(current.size == current.capacity)) {
-            auto newCap = current.capacity ? current.capacity * 2 : 2;
-            auto newObj = MakeObjectOf(newCap, alloc);
-            if (current.object) {
-                ::memcpy(newObj, current.object, sizeof(JsonPair) * current.size);
-            }
-            current.object = newObj;
-            current.capacity = newCap;
-        }
-        current.size = SortedInsertJson(current.object, current.size, {current.key, view}, current.capacity);
-    }
-
-    std::true_type doAdd(JsonView view) {
-        if (meta_Unlikely(current.tag == val)) {
-            result = view;
-        } else if (current.tag == obj) {
-            appendToObject(view);
-        } else { //arr
-            assert(current.tag == arr);
-            appendToArray(view);
-        }
-        return {};
-    }
-
-    std::false_type RawNumber(const char*, size_t, bool) {
-        return {};
-    }
-    void Push() {
-        if (meta_Unlikely(stack.size() == opts.maxDepth)) {
-            throw DepthError{};
-        }
-        stack.push_back(current);
-        current = {};
-    }
-    State Pop() {
-        auto was = current;
-        current = stack.back();
-        stack.pop_back();
-        return was;
-    }
-    std::true_type StartArray() {
-        Push();
-        current.tag = arr;
-        return {};
-    }
-    std::true_type StartObject() {
-        Push();
-        current.tag = obj;
-        return {};
-    }
-    std::true_type EndArray(SizeType) {
-        auto was = Pop();
-        assert(was.tag == arr);
-        doAdd(JsonView(was.array, was.size));
-        return {};
-    }
-    std::true_type EndObject(SizeType) {
-        auto was = Pop();
-        assert(was.tag == obj);
-        doAdd(JsonView(was.object, was.size, JsonView::sorted_tag{}));
-        return {};
-    }
-    std::true_type Null() {
-        return doAdd(nullptr);
-    }
-    std::true_type Bool(bool v) {
-        return doAdd(JsonView(v));
-    }
-    std::true_type String(const Ch* str, rapidjson::SizeType len, bool) {
-        doAdd(string_view{str, len});
-        return {};
-    }
-    std::true_type Key(const Ch* str, rapidjson::SizeType len, bool) {
-        current.key = {str, len};
-        return {};
-    }
-    JsonView Result() const noexcept {
-        return result;
-    }
-
-    std::true_type Int(int v) {
-        doAdd(JsonView(v));
-        return {};
-    }
-    std::true_type Uint(unsigned v) {
-        doAdd(JsonView(v));
-        return {};
-    }
-    std::true_type Int64(int64_t v) {
-        doAdd(JsonView(v));
-        return {};
-    }
-    std::true_type Uint64(uint64_t v) {
-        doAdd(JsonView(v));
-        return {};
-    }
-    std::true_type Double(double v) {
-        doAdd(JsonView(v));
-        return {};
-    }
-};
-
-static std::string atOffset(string_view src, size_t offs) {
-    size_t line = 0;
-    size_t col = 0;
-    for (auto ch: src.substr(0, offs)) {
-        if (ch == '\n') {
-            line++;
-            col = 0;
-        } else {
-            col++;
+static jv::JsonView parseOwnedBuff(char* buff, size_t len, Arena& alloc, ParseSettings params) {
+    if (params.backend == JsonBackend::simd || params.rawKeysCount) {
+        JsonView result;
+        if (detail::ParseJsonSimd(buff, len, true, alloc, params, result)) {
+            return result;
         }
     }
-    return " @ line(" + std::to_string(line) + ") col(" + std::to_string(col) + ")";
-}
-
-static jv::JsonView parseOwnedBuff(char* buff, size_t len, Arena& alloc, ParseSettings params) {
     RapidArenaAllocator rapidAlloc{&alloc};
     GenericReader<UTF8<>, UTF8<>, RapidArenaAllocator> reader(&rapidAlloc);
     LimitedStream stream(buff, len);
@@ -222,13 +74,19 @@ static jv::JsonView parseOwnedBuff(char* buff, size_t len, Arena& alloc, ParseSe
                            | kParseNanAndInfFlag;
     SaxHandler handler{alloc, params};
     try {
-        reader.Parse<flags>(stream, handler);
+        if (params.lazyNumbers) {
+            // numbers are passed as slices of buff and then checked by handler
+            reader.Parse<flags | kParseNumbersAsStringsFlag>(stream, handler);
+        } else {
+            reader.Parse<flags>(stream, handler);
+        }
     } catch (ParsingError& e) {
         e.position = reader.GetErrorOffset();
     }
     if (meta_Unlikely(reader.HasParseError())) {
         auto offs = reader.GetErrorOffset();
-        auto msg = GetParseError_En(reader.GetParseErrorCode()) + atOffset({buff, len}, offs);
+        auto what = handler.numberError ? handler.numberError : GetParseError_En(reader.GetParseErrorCode());
+        auto msg = what + atOffset({buff, len}, offs);
         ParsingError err(std::move(msg));
         err.position = offs;
         throw std::move(err);
@@ -238,18 +96,48 @@ static jv::JsonView parseOwnedBuff(char* buff, size_t len, Arena& alloc, ParseSe
 
 }
 
-jv::JsonView jv::ParseJson(membuff::In& data, Arena& alloc, ParseSettings params) {
+//! Settings which need whole input (t_raw values and lazy numbers reference it)
+static bool needsWholeInput(ParseSettings const& params) noexcept {
+    return params.rawKeysCount || params.lazyNumbers || params.backend == JsonBackend::simd;
+}
+
+static jv::JsonView parseBuffered(membuff::In& data, Arena& alloc, ParseSettings params) {
     ArenaString buff(alloc);
-    if (auto hint = data.TryTotalLeft()) {
-        buff.reserve(hint);
-    }
-    char temp[2048];
-    while (auto read = data.Read(temp, sizeof(temp))) {
-        buff.Append({temp, read});
+    buff.reserve(data.TryTotalLeft() + data.Available());
+    for (;;) {
+        if (!data.Available()) {
+            data.ptr = 0;
+            data.Refill(membuff::NoHint);
+            if (!data.Available()) {
+                break;
+            }
+        }
+        buff.Append({data.buffer + data.ptr, data.Available()});
+        data.ptr += data.Available();
     }
     return parseOwnedBuff(buff.data(), buff.size(), alloc, params);
 }
 
+jv::JsonView jv::ParseJson(membuff::In& data, Arena& alloc, ParseSettings params) {
+    if (needsWholeInput(params)) {
+        // input is read into alloc and kept there
+        return parseBuffered(data, alloc, params);
+    }
+    JsonStreamParser parser(alloc, params);
+    for (;;) {
+        if (!data.Available()) {
+            data.ptr = 0;
+            data.Refill(membuff::NoHint);
+            if (!data.Available()) {
+                break;
+            }
+        }
+        auto status = parser.Feed({data.buffer + data.ptr, data.Available()});
+        data.ptr += status.consumed;
+    }
+    return parser.Finish();
+}
+
 jv::JsonView jv::ParseJsonFile(std::filesystem::path const& file, Arena& alloc, ParseSettings params) {
     std::ifstream source(file);
     if (!source.is_open()) {
@@ -273,6 +161,26 @@ jv::JsonView jv::ParseJsonInPlace(char* buff, size_t len, Arena& alloc, ParseSet
     return parseOwnedBuff(buff, len, alloc, params);
 }
 
+jv::JsonView jv::ParseJsonInPlace(string_view json, Arena& alloc, ParseSettings params) {
+    JsonView result;
+    if (detail::ParseJsonSimd(json.data(), json.size(), false, alloc, params, result)) {
+        return result;
+    }
+    return ParseJson(json, alloc, params);
+}
+
+jv::JsonView jv::Materialize(JsonView raw, Arena& alloc, ParseSettings params) {
+    if (!raw.Is(t_raw)) {
+        return raw;
+    }
+    params.rawKeys = nullptr;
+    params.rawKeysCount = 0;
+    if (raw.GetRawFormat() == RawFormat::msgpack) {
+        return ParseMsgPackInPlace(raw.GetRaw(), alloc, params);
+    }
+    return ParseJsonInPlace(raw.GetRaw(), alloc, params);
+}
+
 jv::JsonView jv::ParseJson(std::istream& data, Arena& alloc, ParseSettings params) {
     membuff::IStreamIn in(data);
     return ParseJson(in, alloc, params);
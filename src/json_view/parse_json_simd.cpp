@@ -0,0 +1,575 @@
+// This file is a part of RPCXX project
+
+/*
+Copyright 2024 "NEOLANT Service", "NEOLANT Kalinigrad", Alexey Doronin, Anastasia Lugovets, Dmitriy Dyakonov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "json_sax.hpp"
+#include "split.hpp"
+#include <array>
+#include <memory>
+
+using namespace jv;
+
+namespace {
+
+// Stage 1: classify input in 64 byte blocks and produce an index of all structural
+// characters ({}[]:, opening quotes of strings and first chars of scalars).
+// Stage 2: walk the index and feed SaxHandler, same as rapidjson backend does.
+
+enum : uint8_t {
+    c_quote = 1,
+    c_escape = 2,
+    c_space = 4,
+    c_op = 8,
+    c_slash = 16,
+};
+
+constexpr auto classes = []{
+    std::array<uint8_t, 256> res{};
+    res[uint8_t('"')] = c_quote;
+    res[uint8_t('\\')] = c_escape;
+    res[uint8_t('/')] = c_slash;
+    for (auto c: {' ', '\t', '\n', '\r'}) {
+        res[uint8_t(c)] = c_space;
+    }
+    for (auto c: {'{', '}', '[', ']', ':', ','}) {
+        res[uint8_t(c)] = c_op;
+    }
+    return res;
+}();
+
+struct Block {
+    uint64_t quote;
+    uint64_t escape;
+    uint64_t space;
+    uint64_t op;
+    uint64_t slash;
+};
+
+using Classifier = void(*)(const char* blk, Block& out);
+
+[[maybe_unused]]
+static void classifyScalar(const char* blk, Block& out) {
+    out = {};
+    for (unsigned i = 0; i < 64; ++i) {
+        uint64_t c = classes[uint8_t(blk[i])];
+        out.quote |= (c & 1) << i;
+        out.escape |= ((c >> 1) & 1) << i;
+        out.space |= ((c >> 2) & 1) << i;
+        out.op |= ((c >> 3) & 1) << i;
+        out.slash |= ((c >> 4) & 1) << i;
+    }
+}
+
+#if JV_SIMD_SSE2
+static void classifySSE2(const char* blk, Block& out) {
+    out = {};
+    const auto quote = _mm_set1_epi8('"');
+    const auto escape = _mm_set1_epi8('\\');
+    const auto slash = _mm_set1_epi8('/');
+    const auto space = _mm_set1_epi8(' ');
+    const auto tab = _mm_set1_epi8('\t');
+    const auto lf = _mm_set1_epi8('\n');
+    const auto cr = _mm_set1_epi8('\r');
+    const auto colon = _mm_set1_epi8(':');
+    const auto comma = _mm_set1_epi8(',');
+    const auto lower = _mm_set1_epi8(0x20);
+    // '[' | 0x20 == '{' and ']' | 0x20 == '}'
+    const auto curlyOpen = _mm_set1_epi8('{');
+    const auto curlyClose = _mm_set1_epi8('}');
+    auto mask = [](__m128i v, unsigned shift) {
+        return uint64_t(uint16_t(_mm_movemask_epi8(v))) << shift;
+    };
+    for (unsigned i = 0; i < 4; ++i) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blk + i * 16));
+        auto low = _mm_or_si128(v, lower);
+        auto ws = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+        auto op = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(low, curlyOpen), _mm_cmpeq_epi8(low, curlyClose)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+        out.quote |= mask(_mm_cmpeq_epi8(v, quote), i * 16);
+        out.escape |= mask(_mm_cmpeq_epi8(v, escape), i * 16);
+        out.slash |= mask(_mm_cmpeq_epi8(v, slash), i * 16);
+        out.space |= mask(ws, i * 16);
+        out.op |= mask(op, i * 16);
+    }
+}
+#endif
+
+#if JV_SIMD_AVX2
+__attribute__((target("avx2")))
+static void classifyAVX2(const char* blk, Block& out) {
+    out = {};
+    const auto quote = _mm256_set1_epi8('"');
+    const auto escape = _mm256_set1_epi8('\\');
+    const auto slash = _mm256_set1_epi8('/');
+    const auto space = _mm256_set1_epi8(' ');
+    const auto tab = _mm256_set1_epi8('\t');
+    const auto lf = _mm256_set1_epi8('\n');
+    const auto cr = _mm256_set1_epi8('\r');
+    const auto colon = _mm256_set1_epi8(':');
+    const auto comma = _mm256_set1_epi8(',');
+    const auto lower = _mm256_set1_epi8(0x20);
+    const auto curlyOpen = _mm256_set1_epi8('{');
+    const auto curlyClose = _mm256_set1_epi8('}');
+    for (unsigned i = 0; i < 2; ++i) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blk + i * 32));
+        auto low = _mm256_or_si256(v, lower);
+        auto ws = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr)));
+        auto op = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(low, curlyOpen), _mm256_cmpeq_epi8(low, curlyClose)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma)));
+        auto shift = i * 32;
+        out.quote |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)))) << shift;
+        out.escape |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, escape)))) << shift;
+        out.slash |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, slash)))) << shift;
+        out.space |= uint64_t(uint32_t(_mm256_movemask_epi8(ws))) << shift;
+        out.op |= uint64_t(uint32_t(_mm256_movemask_epi8(op))) << shift;
+    }
+}
+#endif
+
+static Classifier pickClassifier() noexcept {
+#if JV_SIMD_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return classifyAVX2;
+    }
+#endif
+#if JV_SIMD_SSE2
+    return classifySSE2;
+#else
+    return classifyScalar;
+#endif
+}
+
+// Bit i of result is set if char i is escaped by odd count of backslashes before it
+meta_alwaysInline inline static uint64_t findEscaped(uint64_t backslash, uint64_t& prevEscaped) noexcept {
+    constexpr uint64_t even = 0x5555555555555555ULL;
+    backslash &= ~prevEscaped;
+    uint64_t followsEscape = backslash << 1 | prevEscaped;
+    uint64_t oddStarts = backslash & ~even & ~followsEscape;
+    uint64_t evenStarts = oddStarts + backslash;
+    prevEscaped = evenStarts < oddStarts;
+    uint64_t invert = evenStarts << 1;
+    return (even ^ invert) & followsEscape;
+}
+
+meta_alwaysInline inline static uint64_t prefixXor(uint64_t v) noexcept {
+    v ^= v << 1;
+    v ^= v << 2;
+    v ^= v << 4;
+    v ^= v << 8;
+    v ^= v << 16;
+    v ^= v << 32;
+    return v;
+}
+
+struct Structurals {
+    std::unique_ptr<uint32_t[]> data;
+    size_t capacity = 0;
+    size_t size = 0;
+    bool hasComments = false;
+
+    void Reserve(size_t count) {
+        if (count > capacity) {
+            data.reset(new uint32_t[count]);
+            capacity = count;
+        }
+    }
+    void Shrink() {
+        constexpr size_t keep = 1 << 18;
+        if (capacity > keep) {
+            data.reset();
+            capacity = 0;
+        }
+    }
+};
+
+static void findStructurals(const char* buff, size_t len, Structurals& out) {
+    static const Classifier classify = pickClassifier();
+    // every char may be structural + padding for last block flush
+    out.Reserve(len + 64);
+    out.size = 0;
+    out.hasComments = false;
+    uint32_t* idx = out.data.get();
+    uint64_t prevEscaped = 0;
+    uint64_t prevInString = 0;
+    uint64_t prevScalar = 0;
+    uint64_t comments = 0;
+    char tail[64];
+    for (size_t pos = 0; pos < len; pos += 64) {
+        const char* blk = buff + pos;
+        if (meta_Unlikely(len - pos < 64)) {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, blk, len - pos);
+            blk = tail;
+        }
+        Block b;
+        classify(blk, b);
+        auto escaped = findEscaped(b.escape, prevEscaped);
+        auto quote = b.quote & ~escaped;
+        auto inString = prefixXor(quote) ^ prevInString;
+        prevInString = uint64_t(int64_t(inString) >> 63);
+        auto scalar = ~(b.op | b.space);
+        auto nonQuoteScalar = scalar & ~quote;
+        auto followsScalar = nonQuoteScalar << 1 | prevScalar;
+        prevScalar = nonQuoteScalar >> 63;
+        auto structural = (b.op | (scalar & ~followsScalar)) & ~(inString ^ quote);
+        comments |= b.slash & ~inString;
+        while (structural) {
+            *idx++ = uint32_t(pos + ctz64(structural));
+            structural &= structural - 1;
+        }
+    }
+    out.size = size_t(idx - out.data.get());
+    out.hasComments = comments != 0;
+}
+
+struct Builder {
+    const char* buff;
+    size_t len;
+    const uint32_t* idx;
+    size_t count;
+    SaxHandler& h;
+    //! Buffer is owned by parser => escaped strings are decoded in place, otherwise into arena
+    bool inPlace;
+    size_t cur = 0;
+
+    const char* end() const noexcept {
+        return buff + len;
+    }
+
+    [[noreturn]] void fail(const char* msg, const char* at) {
+        auto offs = size_t(at - buff);
+        ParsingError err(msg + atOffset({buff, len}, offs));
+        err.position = offs;
+        throw std::move(err);
+    }
+
+    const char* take() {
+        if (meta_Unlikely(cur == count)) {
+            fail("Unexpected end of input.", end());
+        }
+        return buff + idx[cur++];
+    }
+
+    bool isDelim(const char* p) const noexcept {
+        return p == end() || (classes[uint8_t(*p)] & (c_space | c_op));
+    }
+
+    unsigned readHex(const char* p) {
+        if (meta_Unlikely(end() - p < 4)) {
+            fail("Incorrect hex digit after \\u escape in string.", p);
+        }
+        unsigned res = 0;
+        for (int i = 0; i < 4; ++i) {
+            auto v = hexValue(p[i]);
+            if (meta_Unlikely(v < 0)) {
+                fail("Incorrect hex digit after \\u escape in string.", p + i);
+            }
+            res = res << 4 | unsigned(v);
+        }
+        return res;
+    }
+
+    // Decoded string is never longer than escaped one => its size is enough
+    char* unescapeBuffer(const char* start, const char* firstSpecial) {
+        auto close = firstSpecial;
+        for (;;) {
+            close = findStringSpecial(close, end());
+            if (close == end() || *close == '"') {
+                break;
+            }
+            close = *close == '\\' && end() - close > 1 ? close + 2 : close + 1;
+        }
+        auto res = static_cast<char*>(h.alloc.Allocate(size_t(close - start), 1));
+        memcpy(res, start, size_t(firstSpecial - start));
+        return res;
+    }
+
+    // q points to opening quote. Escaped strings are decoded in place or copied (see inPlace)
+    string_view string(const char* q) {
+        const char* const start = q + 1;
+        const char* src = findStringSpecial(start, end());
+        if (meta_Likely(src != end() && *src == '"')) {
+            return {start, size_t(src - start)};
+        }
+        char* const out = inPlace ? const_cast<char*>(start) : unescapeBuffer(start, src);
+        char* dst = out + (src - start);
+        for (;;) {
+            if (meta_Unlikely(src == end())) {
+                fail("Missing a closing quotation mark in string.", q);
+            }
+            if (*src == '"') {
+                return {out, size_t(dst - out)};
+            }
+            if (meta_Unlikely(*src != '\\')) {
+                fail("Invalid encoding in string.", src);
+            }
+            if (meta_Unlikely(end() - src < 2)) {
+                fail("Missing a closing quotation mark in string.", q);
+            }
+            auto esc = src[1];
+            src += 2;
+            switch (esc) {
+            case '"': *dst++ = '"'; break;
+            case '\\': *dst++ = '\\'; break;
+            case '/': *dst++ = '/'; break;
+            case 'b': *dst++ = '\b'; break;
+            case 'f': *dst++ = '\f'; break;
+            case 'n': *dst++ = '\n'; break;
+            case 'r': *dst++ = '\r'; break;
+            case 't': *dst++ = '\t'; break;
+            case 'u': {
+                auto cp = readHex(src);
+                src += 4;
+                if (meta_Unlikely(cp >= 0xD800 && cp <= 0xDFFF)) {
+                    if (meta_Unlikely(cp > 0xDBFF
+                                      || end() - src < 2 || src[0] != '\\' || src[1] != 'u')) {
+                        fail("The surrogate pair in string is invalid.", src);
+                    }
+                    auto low = readHex(src + 2);
+                    if (meta_Unlikely(low < 0xDC00 || low > 0xDFFF)) {
+                        fail("The surrogate pair in string is invalid.", src);
+                    }
+                    src += 6;
+                    cp = (((cp - 0xD800) << 10) | (low - 0xDC00)) + 0x10000;
+                }
+                dst = writeUtf8(dst, cp);
+                break;
+            }
+            default:
+                fail("Invalid escape character in string.", src - 1);
+            }
+            auto next = findStringSpecial(src, end());
+            memmove(dst, src, size_t(next - src));
+            dst += next - src;
+            src = next;
+        }
+    }
+
+    void scalar(const char* p) {
+        switch (*p) {
+        case '"': {
+            auto str = string(p);
+            h.String(str.data(), unsigned(str.size()), true);
+            break;
+        }
+        default: {
+            auto tokenEnd = p;
+            while (!isDelim(tokenEnd)) ++tokenEnd;
+            const char* errAt;
+            if (auto err = emitScalar(h, p, tokenEnd, errAt)) {
+                fail(err, errAt);
+            }
+        }
+        }
+    }
+
+    // Value is skipped over structurals, only brackets are checked
+    void raw(const char* p) {
+        const char* last;
+        if (*p == '{' || *p == '[') {
+            std::string closers(1, *p == '{' ? '}' : ']');
+            while (!closers.empty()) {
+                last = take();
+                if (*last == '{' || *last == '[') {
+                    if (meta_Unlikely(h.stack.size() + closers.size() >= h.opts.maxDepth)) {
+                        throw DepthError{};
+                    }
+                    closers.push_back(*last == '{' ? '}' : ']');
+                } else if (*last == '}' || *last == ']') {
+                    if (meta_Unlikely(*last != closers.back())) {
+                        fail(closers.back() == '}'
+                             ? "Missing a comma or '}' after an object member."
+                             : "Missing a comma or ']' after an array element.", last);
+                    }
+                    closers.pop_back();
+                }
+            }
+            last++;
+        } else if (meta_Unlikely(classes[uint8_t(*p)] & c_op)) {
+            fail("Invalid value.", p);
+        } else {
+            last = cur < count ? buff + idx[cur] : end();
+            while (last != p && (classes[uint8_t(last[-1])] & c_space)) {
+                last--;
+            }
+        }
+        h.RawValue({p, size_t(last - p)});
+    }
+
+    // p points to key. Returns start of value
+    const char* member(const char* p) {
+        if (meta_Unlikely(*p != '"')) {
+            fail("Missing a name for object member.", p);
+        }
+        auto key = string(p);
+        h.Key(key.data(), unsigned(key.size()), true);
+        p = take();
+        if (meta_Unlikely(*p != ':')) {
+            fail("Missing a colon after a name of object member.", p);
+        }
+        return take();
+    }
+
+    JsonView Run() {
+        if (meta_Unlikely(!count)) {
+            fail("The document is empty.", end());
+        }
+        const char* p = take();
+        const bool rawKeys = h.opts.rawKeysCount;
+        for (;;) {
+            if (meta_Unlikely(rawKeys) && h.WantsRaw()) {
+                raw(p);
+            } else if (*p == '{') {
+                h.StartObject();
+                p = take();
+                if (*p != '}') {
+                    p = member(p);
+                    continue;
+                }
+                h.EndObject(0);
+            } else if (*p == '[') {
+                h.StartArray();
+                p = take();
+                if (*p != ']') {
+                    continue;
+                }
+                h.EndArray(0);
+            } else {
+                scalar(p);
+            }
+            // value done: close containers until there is a next value
+            for (;;) {
+                auto tag = h.current.tag;
+                if (tag == SaxHandler::val) {
+                    if (meta_Unlikely(cur != count)) {
+                        fail("The document root must not be followed by other values.", buff + idx[cur]);
+                    }
+                    return h.Result();
+                }
+                bool isObj = tag == SaxHandler::obj;
+                char close = isObj ? '}' : ']';
+                p = take();
+                if (*p == ',') {
+                    p = take();
+                    if (*p != close) { // trailing comma is allowed
+                        break;
+                    }
+                } else if (meta_Unlikely(*p != close)) {
+                    fail(isObj
+                         ? "Missing a comma or '}' after an object member."
+                         : "Missing a comma or ']' after an array element.", p);
+                }
+                if (isObj) {
+                    h.EndObject(0);
+                } else {
+                    h.EndArray(0);
+                }
+            }
+            if (h.current.tag == SaxHandler::obj) {
+                p = member(p);
+            }
+        }
+    }
+};
+
+}
+
+bool jv::detail::ParseJsonSimd(const char* buff, size_t len, bool inPlace, Arena& alloc, ParseSettings const& opts, JsonView& out)
+{
+    if (meta_Unlikely(len >= std::numeric_limits<uint32_t>::max())) {
+        return false;
+    }
+    static thread_local Structurals index;
+    findStructurals(buff, len, index);
+    if (meta_Unlikely(index.hasComments)) {
+        return false;
+    }
+    SaxHandler handler{alloc, opts};
+    Builder builder{buff, len, index.data.get(), index.size, handler, inPlace};
+    try {
+        out = builder.Run();
+    } catch (...) {
+        index.Shrink();
+        throw;
+    }
+    index.Shrink();
+    return true;
+}
+
+bool jv::detail::SplitJsonArray(const char* buff, size_t len, std::vector<string_view>& out)
+{
+    if (meta_Unlikely(len >= std::numeric_limits<uint32_t>::max())) {
+        return false;
+    }
+    static thread_local Structurals index;
+    findStructurals(buff, len, index);
+    auto idx = index.data.get();
+    auto count = index.size;
+    bool ok = !index.hasComments && count && buff[idx[0]] == '[';
+    unsigned depth = 0;
+    const char* element = nullptr;
+    bool closed = false;
+    for (size_t i = 1; ok && i < count; ++i) {
+        auto p = buff + idx[i];
+        auto c = *p;
+        if (depth) {
+            if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                depth--;
+            }
+        } else if (!element) {
+            if (c == ']') {
+                closed = true;
+                ok = i + 1 == count;
+            } else if (c == ',' || c == '}' || c == ':') {
+                ok = false;
+            } else {
+                element = p;
+                depth = c == '{' || c == '[';
+            }
+        } else if (c == ',' || c == ']') {
+            auto last = p;
+            while (last != element && (last[-1] == ' ' || last[-1] == '\n' || last[-1] == '\r' || last[-1] == '\t')) {
+                last--;
+            }
+            out.push_back({element, size_t(last - element)});
+            element = nullptr;
+            if (c == ']') {
+                closed = true;
+                ok = i + 1 == count;
+            }
+        } else {
+            ok = false;
+        }
+    }
+    index.Shrink();
+    return ok && closed;
+}
@@ -0,0 +1,489 @@
+// This file is a part of RPCXX project
+
+/*
+Copyright 2024 "NEOLANT Service", "NEOLANT Kalinigrad", Alexey Doronin, Anastasia Lugovets, Dmitriy Dyakonov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "json_sax.hpp"
+
+using namespace jv;
+
+namespace {
+
+enum StreamState : uint8_t {
+    s_value,
+    s_value_or_close,
+    s_key_or_close,
+    s_colon,
+    s_after_value,
+    s_trailing,
+    s_string,
+    s_escape,
+    s_unicode,
+    s_surrogate_slash,
+    s_surrogate_u,
+    s_token,
+    s_comment_start,
+    s_line_comment,
+    s_block_comment,
+    s_block_star,
+};
+
+inline bool isSpace(char c) noexcept {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline bool isTokenEnd(char c) noexcept {
+    switch (c) {
+    case ' ': case '\n': case '\r': case '\t':
+    case ',': case ':': case '[': case ']': case '{': case '}':
+    case '"': case '/':
+        return true;
+    default:
+        return false;
+    }
+}
+
+}
+
+struct JsonStreamParser::Impl {
+    Arena& alloc;
+    //! own elements stack: several parsers may be active on one thread.
+    //! It is kept in alloc, so that its limit bounds open containers of streamed document
+    SaxScratch elements;
+    SaxHandler h;
+    //! partial string or token, when it is split between chunks (or string has escapes)
+    ArenaString scratch;
+    const char* chunk = nullptr;
+    size_t offset = 0;
+    size_t line = 0;
+    size_t lineStart = 0;
+    size_t tokenStart = 0;
+    unsigned codepoint = 0;
+    unsigned highSurrogate = 0;
+    uint8_t hexLeft = 0;
+    StreamState state = s_value;
+    StreamState afterComment = s_value;
+    bool isKey = false;
+    bool started = false;
+    bool done = false;
+
+    Impl(Arena& alloc, ParseSettings const& params) :
+        alloc(alloc), elements(alloc), h{alloc, eager(params), elements}, scratch(alloc)
+    {}
+
+    //! Chunks are not kept after Feed() => numbers cannot reference them
+    static ParseSettings eager(ParseSettings params) noexcept {
+        params.lazyNumbers = false;
+        return params;
+    }
+    size_t abs(const char* p) const noexcept {
+        return offset + size_t(p - chunk);
+    }
+
+    [[noreturn]] void fail(const char* msg, size_t at) {
+        auto l = line;
+        auto start = lineStart;
+        if (chunk && at > offset) {
+            for (size_t i = 0; i < at - offset; ++i) {
+                if (chunk[i] == '\n') {
+                    l++;
+                    start = offset + i + 1;
+                }
+            }
+        }
+        auto col = at > start ? at - start : 0;
+        ParsingError err(msg + (" @ line(" + std::to_string(l) + ") col(" + std::to_string(col) + ")"));
+        err.position = at;
+        throw std::move(err);
+    }
+
+    [[noreturn]] void fail(const char* msg, const char* at) {
+        fail(msg, abs(at));
+    }
+
+    void append(const char* beg, const char* end) {
+        if (end != beg) {
+            scratch.Append({beg, size_t(end - beg)});
+        }
+    }
+
+    void valueDone() {
+        if (h.current.tag == SaxHandler::val) {
+            done = true;
+            state = s_trailing;
+        } else {
+            state = s_after_value;
+        }
+    }
+
+    void beginString(const char* quote, bool key) {
+        scratch.clear();
+        tokenStart = abs(quote);
+        isKey = key;
+        state = s_string;
+    }
+
+    void finishString(string_view str) {
+        if (isKey) {
+            h.Key(str.data(), unsigned(str.size()), true);
+            state = s_colon;
+        } else {
+            h.String(str.data(), unsigned(str.size()), true);
+            valueDone();
+        }
+    }
+
+    void emitToken(const char* beg, const char* end) {
+        const char* errAt;
+        if (auto err = emitScalar(h, beg, end, errAt)) {
+            fail(err, tokenStart + size_t(errAt - beg));
+        }
+        valueDone();
+    }
+
+    const char* value(const char* p) {
+        switch (*p) {
+        case '{':
+            h.StartObject();
+            state = s_key_or_close;
+            return p + 1;
+        case '[':
+            h.StartArray();
+            state = s_value_or_close;
+            return p + 1;
+        case '"':
+            beginString(p, false);
+            return p + 1;
+        case ',': case ':': case '}': case ']':
+            fail("Invalid value.", p);
+        default:
+            scratch.clear();
+            tokenStart = abs(p);
+            state = s_token;
+            return p;
+        }
+    }
+
+    const char* structural(const char* p, const char* end) {
+        while (p != end && isSpace(*p)) ++p;
+        if (p == end) {
+            return p;
+        }
+        auto c = *p;
+        if (c == '/') {
+            afterComment = state;
+            state = s_comment_start;
+            return p + 1;
+        }
+        started = true;
+        switch (state) {
+        case s_value_or_close:
+            if (c == ']') {
+                h.EndArray(0);
+                valueDone();
+                return p + 1;
+            }
+            return value(p);
+        case s_value:
+            return value(p);
+        case s_key_or_close:
+            if (c == '}') {
+                h.EndObject(0);
+                valueDone();
+                return p + 1;
+            }
+            if (meta_Unlikely(c != '"')) {
+                fail("Missing a name for object member.", p);
+            }
+            beginString(p, true);
+            return p + 1;
+        case s_colon:
+            if (meta_Unlikely(c != ':')) {
+                fail("Missing a colon after a name of object member.", p);
+            }
+            state = s_value;
+            return p + 1;
+        case s_after_value: {
+            bool isObj = h.current.tag == SaxHandler::obj;
+            if (c == ',') {
+                state = isObj ? s_key_or_close : s_value_or_close;
+                return p + 1;
+            }
+            if (meta_Unlikely(c != (isObj ? '}' : ']'))) {
+                fail(isObj
+                     ? "Missing a comma or '}' after an object member."
+                     : "Missing a comma or ']' after an array element.", p);
+            }
+            if (isObj) {
+                h.EndObject(0);
+            } else {
+                h.EndArray(0);
+            }
+            valueDone();
+            return p + 1;
+        }
+        default:
+            fail("The document root must not be followed by other values.", p);
+        }
+    }
+
+    const char* string(const char* p, const char* end) {
+        auto q = findStringSpecial(p, end);
+        if (q == end) {
+            append(p, q);
+            return q;
+        }
+        if (meta_Likely(*q == '"')) {
+            if (scratch.empty()) {
+                finishString(CopyString({p, size_t(q - p)}, alloc));
+            } else {
+                append(p, q);
+                finishString(CopyString(scratch, alloc));
+            }
+            return q + 1;
+        }
+        if (meta_Unlikely(*q != '\\')) {
+            fail("Invalid encoding in string.", q);
+        }
+        append(p, q);
+        state = s_escape;
+        return q + 1;
+    }
+
+    const char* escape(const char* p) {
+        char res;
+        switch (*p) {
+        case '"': res = '"'; break;
+        case '\\': res = '\\'; break;
+        case '/': res = '/'; break;
+        case 'b': res = '\b'; break;
+        case 'f': res = '\f'; break;
+        case 'n': res = '\n'; break;
+        case 'r': res = '\r'; break;
+        case 't': res = '\t'; break;
+        case 'u':
+            codepoint = 0;
+            hexLeft = 4;
+            state = s_unicode;
+            return p + 1;
+        default:
+            fail("Invalid escape character in string.", p);
+        }
+        scratch.push_back(res);
+        state = s_string;
+        return p + 1;
+    }
+
+    const char* unicode(const char* p, const char* end) {
+        for (; p != end && hexLeft; ++p, --hexLeft) {
+            auto v = hexValue(*p);
+            if (meta_Unlikely(v < 0)) {
+                fail("Incorrect hex digit after \\u escape in string.", p);
+            }
+            codepoint = codepoint << 4 | unsigned(v);
+        }
+        if (hexLeft) {
+            return p;
+        }
+        auto cp = codepoint;
+        if (highSurrogate) {
+            if (meta_Unlikely(cp < 0xDC00 || cp > 0xDFFF)) {
+                fail("The surrogate pair in string is invalid.", p);
+            }
+            cp = (((highSurrogate - 0xD800) << 10) | (cp - 0xDC00)) + 0x10000;
+            highSurrogate = 0;
+        } else if (cp >= 0xD800 && cp <= 0xDBFF) {
+            highSurrogate = cp;
+            state = s_surrogate_slash;
+            return p;
+        } else if (meta_Unlikely(cp >= 0xDC00 && cp <= 0xDFFF)) {
+            fail("The surrogate pair in string is invalid.", p);
+        }
+        char buff[4];
+        append(buff, writeUtf8(buff, cp));
+        state = s_string;
+        return p;
+    }
+
+    const char* surrogate(const char* p) {
+        if (meta_Unlikely(*p != (state == s_surrogate_slash ? '\\' : 'u'))) {
+            fail("The surrogate pair in string is invalid.", p);
+        }
+        if (state == s_surrogate_slash) {
+            state = s_surrogate_u;
+        } else {
+            codepoint = 0;
+            hexLeft = 4;
+            state = s_unicode;
+        }
+        return p + 1;
+    }
+
+    const char* token(const char* p, const char* end) {
+        auto q = p;
+        while (q != end && !isTokenEnd(*q)) ++q;
+        if (q == end) {
+            append(p, q);
+        } else if (scratch.empty()) {
+            emitToken(p, q);
+        } else {
+            append(p, q);
+            emitToken(scratch.data(), scratch.data() + scratch.size());
+        }
+        return q;
+    }
+
+    const char* comment(const char* p, const char* end) {
+        switch (state) {
+        case s_comment_start:
+            if (*p == '/') {
+                state = s_line_comment;
+            } else if (*p == '*') {
+                state = s_block_comment;
+            } else {
+                fail("Invalid value.", p);
+            }
+            return p + 1;
+        case s_line_comment: {
+            auto nl = static_cast<const char*>(memchr(p, '\n', size_t(end - p)));
+            if (!nl) {
+                return end;
+            }
+            state = afterComment;
+            return nl + 1;
+        }
+        case s_block_comment: {
+            auto star = static_cast<const char*>(memchr(p, '*', size_t(end - p)));
+            if (!star) {
+                return end;
+            }
+            state = s_block_star;
+            return star + 1;
+        }
+        default: // s_block_star
+            if (*p == '/') {
+                state = afterComment;
+            } else if (*p != '*') {
+                state = s_block_comment;
+            }
+            return p + 1;
+        }
+    }
+
+    size_t Feed(const char* begin, const char* end) {
+        chunk = begin;
+        auto p = begin;
+        auto wasDone = done;
+        while (p != end) {
+            switch (state) {
+            case s_string: p = string(p, end); break;
+            case s_escape: p = escape(p); break;
+            case s_unicode: p = unicode(p, end); break;
+            case s_surrogate_slash:
+            case s_surrogate_u: p = surrogate(p); break;
+            case s_token: p = token(p, end); break;
+            case s_comment_start:
+            case s_line_comment:
+            case s_block_comment:
+            case s_block_star: p = comment(p, end); break;
+            default: p = structural(p, end); break;
+            }
+            if (!wasDone && done) {
+                break;
+            }
+        }
+        for (auto it = begin; it != p; ++it) {
+            if (*it == '\n') {
+                line++;
+                lineStart = abs(it) + 1;
+            }
+        }
+        offset += size_t(p - begin);
+        chunk = nullptr;
+        return size_t(p - begin);
+    }
+
+    JsonView Finish() {
+        if (state == s_token) {
+            emitToken(scratch.data(), scratch.data() + scratch.size());
+        } else if (state == s_line_comment) {
+            state = afterComment;
+        }
+        switch (state) {
+        case s_trailing:
+            return h.Result();
+        case s_string:
+        case s_escape:
+        case s_unicode:
+        case s_surrogate_slash:
+        case s_surrogate_u:
+            fail("Missing a closing quotation mark in string.", tokenStart);
+        case s_comment_start:
+        case s_block_comment:
+        case s_block_star:
+            fail("Unspecific syntax error.", offset);
+        case s_value:
+            if (!started) {
+                fail("The document is empty.", offset);
+            }
+            [[fallthrough]];
+        default:
+            fail("Unexpected end of input.", offset);
+        }
+    }
+};
+
+JsonStreamParser::JsonStreamParser(Arena& alloc, ParseSettings params) :
+    d(new (alloc(sizeof(Impl), alignof(Impl))) Impl(alloc, params))
+{}
+
+JsonStreamParser::JsonStreamParser(JsonStreamParser&& other) noexcept :
+    d(std::exchange(other.d, nullptr))
+{}
+
+JsonStreamParser& JsonStreamParser::operator=(JsonStreamParser&& other) noexcept {
+    std::swap(d, other.d);
+    return *this;
+}
+
+JsonStreamParser::~JsonStreamParser() {
+    if (d) {
+        d->~Impl();
+    }
+}
+
+JsonStreamParser::Status JsonStreamParser::Feed(string_view chunk) {
+    auto consumed = d->Feed(chunk.data(), chunk.data() + chunk.size());
+    return {consumed, d->done};
+}
+
+JsonView JsonStreamParser::Finish() {
+    return d->Finish();
+}
+
+bool JsonStreamParser::Done() const noexcept {
+    return d->done;
+}
+
+JsonView JsonStreamParser::Result() const noexcept {
+    return d->h.Result();
+}
@@ -27,6 +27,7 @@ SOFTWARE.
 #include <algorithm>
 #include <string.h>
 #include "endian.hpp"
+#include "split.hpp"
 
 using namespace jv;
 
@@ -43,6 +44,8 @@ struct State {
     const char* ptr;
     const char* end;
     ParseSettings& opts;
+    //! objects at this depth may have ParseSettings::rawKeys
+    unsigned rawDepth;
     meta_alwaysInline
     constexpr size_t Left() const noexcept {
         return end - ptr;
@@ -133,6 +136,109 @@ static JsonView unpackExt(State& state) noexcept {
     return JsonView::Binary({state.Consume(total), total});
 }
 
+enum LenKind : uint8_t {
+    l_none,
+    l_bytes, //str, bin
+    l_ext, //ext: type tag follows length
+    l_items, //array
+    l_pairs, //map
+};
+
+//! What follows a header byte: length field (lenSize bytes) and/or fixed number of bytes/items
+struct HeadInfo {
+    uint8_t lenSize = 0;
+    LenKind kind = l_none;
+    size_t skip = 0;
+    size_t items = 0;
+};
+
+//! Returns error for invalid header
+static const char* headInfo(uint8_t head, HeadInfo& out) noexcept
+{
+    out = {};
+    if (head <= 0x7f || head >= 0xe0) {
+        //fixint
+    } else if (head <= 0x8f) {
+        out.items = size_t(head & 0b1111) * 2;
+    } else if (head <= 0x9f) {
+        out.items = head & 0b1111;
+    } else if (head <= 0xbf) {
+        out.skip = head & 0b11111;
+    } else {
+        switch (head) {
+        case 0xc0: case 0xc2: case 0xc3: break;
+        case 0xcc: case 0xd0: out.skip = 1; break;
+        case 0xcd: case 0xd1: out.skip = 2; break;
+        case 0xce: case 0xd2: case 0xca: out.skip = 4; break;
+        case 0xcf: case 0xd3: case 0xcb: out.skip = 8; break;
+        case 0xd4: out.skip = 2; break;
+        case 0xd5: out.skip = 3; break;
+        case 0xd6: out.skip = 5; break;
+        case 0xd7: out.skip = 9; break;
+        case 0xd8: out.skip = 17; break;
+        case 0xd9: case 0xc4: out = {1, l_bytes}; break;
+        case 0xda: case 0xc5: out = {2, l_bytes}; break;
+        case 0xdb: case 0xc6: out = {4, l_bytes}; break;
+        case 0xc7: out = {1, l_ext}; break;
+        case 0xc8: out = {2, l_ext}; break;
+        case 0xc9: out = {4, l_ext}; break;
+        case 0xdc: out = {2, l_items}; break;
+        case 0xdd: out = {4, l_items}; break;
+        case 0xde: out = {2, l_pairs}; break;
+        case 0xdf: out = {4, l_pairs}; break;
+        case 0xc1: return "0xC1 is not allowed in MsgPack";
+        default: return "unknown type";
+        }
+    }
+    return nullptr;
+}
+
+//! Apply big-endian length field of lenSize bytes
+static void applyLength(HeadInfo& info, const char* len) noexcept
+{
+    size_t value = 0;
+    switch (info.lenSize) {
+    case 1: value = fromBig<uint8_t>(len); break;
+    case 2: value = fromBig<uint16_t>(len); break;
+    case 4: value = fromBig<uint32_t>(len); break;
+    default: return;
+    }
+    switch (info.kind) {
+    case l_bytes: info.skip = value; break;
+    case l_ext: info.skip = value + 1; break;
+    case l_items: info.items = value; break;
+    case l_pairs: info.items = value * 2; break;
+    default: break;
+    }
+}
+
+// Finds end of value without parsing it
+static JsonView skipRaw(State& state) noexcept
+{
+    auto begin = state.ptr;
+    size_t left = 1;
+    while (left) {
+        if (meta_Unlikely(state.Left() < left)) {
+            return ErrEOF;
+        }
+        left--;
+        HeadInfo info;
+        if (auto err = headInfo(uint8_t(*state.ptr++), info)) {
+            return JsonView::Discarded(err);
+        }
+        if (meta_Unlikely(state.Left() < info.lenSize)) {
+            return ErrEOF;
+        }
+        applyLength(info, state.Consume(info.lenSize));
+        if (meta_Unlikely(state.Left() < info.skip || state.Left() < info.items)) {
+            return ErrEOF;
+        }
+        state.Consume(info.skip);
+        left += info.items;
+    }
+    return JsonView::Raw({begin, size_t(state.ptr - begin)}, RawFormat::msgpack);
+}
+
 JsonView parseOne(State& state, Arena& alloc, unsigned depth) noexcept
 {
     if (meta_Unlikely(!depth)) {
@@ -229,16 +335,19 @@ JsonView parseOne(State& state, Arena& alloc, unsigned depth) noexcept
 JsonView parseObject(unsigned count, State& state, Arena& alloc, unsigned int depth) noexcept try
 {
     auto obj = MakeObjectOf(count, alloc);
-    unsigned size = 0;
+    const bool rawKeys = depth == state.rawDepth && state.opts.rawKeysCount;
     for (size_t i = 0u; i < count; ++i) {
         auto key = parseOne(state, alloc, depth);
         _CHECK(key);
         if (meta_Unlikely(!key.Is(t_string)))
             return JsonView::Discarded("keys must be string");
-        auto value = parseOne(state, alloc, depth);
+        auto value = meta_Unlikely(rawKeys) && state.opts.IsRawKey(key.GetStringUnsafe())
+                         ? skipRaw(state)
+                         : parseOne(state, alloc, depth);
         _CHECK(value);
-        size = SortedInsertJson(obj, size, {key.GetStringUnsafe(), value}, count);
+        obj[i] = {key.GetStringUnsafe(), value};
     }
+    auto size = SortUniqueJson(obj, count);
     return JsonView(obj, size, JsonView::sorted_tag{});
 } catch(...) {
     return ErrOOM;
@@ -247,6 +356,10 @@ JsonView parseObject(unsigned count, State& state, Arena& alloc, unsigned int de
 JsonView parseArray(unsigned int count, State& state, Arena& alloc, unsigned int depth) noexcept try
 {
     auto arr = MakeArrayOf(count, alloc);
+    if (depth + 1 == state.opts.maxDepth) {
+        // top-level array (batch): rawKeys apply to its objects
+        state.rawDepth = depth - 1;
+    }
     for (size_t i = 0u; i < count; ++i) {
         arr[i] = parseOne(state, alloc, depth);
         _CHECK(arr[i]);
@@ -258,21 +371,58 @@ JsonView parseArray(unsigned int count, State& state, Arena& alloc, unsigned int
 
 } // anon
 
+bool jv::detail::SplitMsgPackArray(string_view data, std::vector<string_view>& out, size_t& consumed)
+{
+    ParseSettings opts;
+    State state{data.data(), data.data() + data.size(), opts, 0};
+    if (!state.Left()) {
+        return false;
+    }
+    auto head = uint8_t(*state.ptr++);
+    size_t count;
+    if (head >= 0x90 && head <= 0x9f) {
+        count = head & 0b1111;
+    } else if (head == 0xdc || head == 0xdd) {
+        auto len = head == 0xdc ? unpackTrivial<uint16_t>(state) : unpackTrivial<uint32_t>(state);
+        if (len.Is(t_discarded)) {
+            return false;
+        }
+        count = size_t(len.GetUnsafe().d.uinteger);
+    } else {
+        return false;
+    }
+    if (state.Left() < count) {
+        return false;
+    }
+    out.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto element = skipRaw(state);
+        if (!element.Is(t_raw)) {
+            return false;
+        }
+        out.push_back(element.GetRaw());
+    }
+    consumed = size_t(state.ptr - data.data());
+    return true;
+}
+
+[[noreturn]] static void throwError(string_view reason, size_t at)
+{
+    if (reason == ErrOOM.GetDiscardReason()) {
+        throw std::bad_alloc();
+    }
+    auto err = ParsingError("msgpack parse error: " + std::string(reason) + " @" + std::to_string(at));
+    err.position = at;
+    throw err;
+}
+
 jv::ParseResult jv::ParseMsgPackInPlace(string_view data, Arena& alloc, ParseSettings opts)
 {
-    State state{data.data(), data.data() + data.size(), opts};
+    State state{data.data(), data.data() + data.size(), opts, opts.maxDepth - 1};
     auto result = parseOne(state, alloc, opts.maxDepth);
     auto consumed = size_t(state.ptr - data.data());
     if (result.Is(t_discarded)) {
-        if (result.GetDiscardReason() == ErrOOM.GetDiscardReason()) {
-            throw std::bad_alloc();
-        }
-        auto err = ParsingError(
-            "msgpack parse error: " +
-            std::string(result.GetDiscardReason()) +
-            " @" + std::to_string(state.ptr - data.data()));
-        err.position = state.ptr - data.data();
-        throw err;
+        throwError(result.GetDiscardReason(), consumed);
     }
     return {result, consumed};
 }
@@ -300,3 +450,143 @@ jv::ParseResult jv::ParseMsgPack(membuff::In& reader, Arena& alloc, ParseSetting
     }
     return ParseMsgPackInPlace(buff, alloc, params);
 }
+
+struct MsgPackStreamParser::Impl {
+    Arena& alloc;
+    ParseSettings params;
+    //! bytes of unfinished message, when it is split between chunks
+    ArenaString partial;
+    JsonView result = {};
+    size_t offset = 0;
+    //! values of current message, which are not yet seen
+    size_t left = 1;
+    //! payload bytes of current value, which are not yet seen
+    size_t skip = 0;
+    HeadInfo info;
+    char head[5];
+    uint8_t headSize = 0;
+    bool done = false;
+    //! start of chunk being scanned (for error positions)
+    const char* scanBegin = nullptr;
+
+    Impl(Arena& alloc, ParseSettings const& params) :
+        alloc(alloc), params(params), partial(alloc)
+    {}
+
+    // Returns end of current message or chunk
+    const char* scan(const char* p, const char* end) {
+        while (p != end) {
+            if (skip) {
+                auto step = (std::min)(skip, size_t(end - p));
+                p += step;
+                skip -= step;
+                continue;
+            }
+            if (!left) {
+                break;
+            }
+            if (!headSize) {
+                if (auto err = headInfo(uint8_t(*p), info)) {
+                    throwError(err, offset + partial.size() + size_t(p - scanBegin));
+                }
+                head[headSize++] = *p++;
+            }
+            while (headSize < 1 + info.lenSize && p != end) {
+                head[headSize++] = *p++;
+            }
+            if (headSize < 1 + info.lenSize) {
+                break;
+            }
+            applyLength(info, head + 1);
+            headSize = 0;
+            left += info.items - 1;
+            skip = info.skip;
+        }
+        done = !left && !skip && !headSize;
+        return p;
+    }
+
+    size_t Feed(const char* begin, const char* end) {
+        if (done && begin == end) {
+            // nothing of next message yet: keep previous result
+            return 0;
+        }
+        if (done) {
+            // result references previous buffer
+            offset += partial.size();
+            partial = ArenaString(alloc);
+            result = {};
+            left = 1;
+            done = false;
+        }
+        scanBegin = begin;
+        auto stop = scan(begin, end);
+        auto used = size_t(stop - begin);
+        if (!done) {
+            partial.Append({begin, used});
+            return used;
+        }
+        string_view msg;
+        if (partial.empty()) {
+            // whole message is inside of chunk: copy it once
+            auto buff = static_cast<char*>(alloc.Allocate(used, 1));
+            memcpy(buff, begin, used);
+            msg = {buff, used};
+        } else {
+            partial.Append({begin, used});
+            msg = partial;
+        }
+        State state{msg.data(), msg.data() + msg.size(), params, params.maxDepth - 1};
+        result = parseOne(state, alloc, params.maxDepth);
+        if (result.Is(t_discarded)) {
+            throwError(result.GetDiscardReason(), offset + size_t(state.ptr - msg.data()));
+        }
+        if (partial.empty()) {
+            offset += used;
+        }
+        return used;
+    }
+};
+
+MsgPackStreamParser::MsgPackStreamParser(Arena& alloc, ParseSettings params) :
+    d(new (alloc(sizeof(Impl), alignof(Impl))) Impl(alloc, params))
+{}
+
+MsgPackStreamParser::MsgPackStreamParser(MsgPackStreamParser&& other) noexcept :
+    d(std::exchange(other.d, nullptr))
+{}
+
+MsgPackStreamParser& MsgPackStreamParser::operator=(MsgPackStreamParser&& other) noexcept {
+    std::swap(d, other.d);
+    return *this;
+}
+
+MsgPackStreamParser::~MsgPackStreamParser() {
+    if (d) {
+        d->~Impl();
+    }
+}
+
+MsgPackStreamParser::Status MsgPackStreamParser::Feed(string_view chunk) {
+    auto consumed = d->Feed(chunk.data(), chunk.data() + chunk.size());
+    return {consumed, d->done};
+}
+
+JsonView MsgPackStreamParser::Finish() {
+    if (!d->done) {
+        throwError(d->partial.empty() ? "no message" : "unexpected eof", d->offset + d->partial.size());
+    }
+    return d->result;
+}
+
+bool MsgPackStreamParser::Done() const noexcept {
+    return d->done;
+}
+
+bool MsgPackStreamParser::Pending() const noexcept {
+    return !d->done && !d->partial.empty();
+}
+
+JsonView MsgPackStreamParser::Result() const noexcept {
+    return d->result;
+}
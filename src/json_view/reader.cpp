@@ -0,0 +1,531 @@
+// This file is a part of RPCXX project
+
+/*
+Copyright 2024 "NEOLANT Service", "NEOLANT Kalinigrad", Alexey Doronin, Anastasia Lugovets, Dmitriy Dyakonov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "json_view/reader.hpp"
+#include "json_sax.hpp"
+#include "endian.hpp"
+
+using namespace jv;
+
+namespace {
+
+struct ScalarSink {
+    JsonView result;
+    void Null() { result = nullptr; }
+    void Bool(bool v) { result = JsonView(v); }
+    void Int64(int64_t v) { result = JsonView(v); }
+    void Uint64(uint64_t v) { result = JsonView(v); }
+    void Double(double v) { result = JsonView(v); }
+    // values are read right away => nothing to gain from lazy numbers
+    bool LazyNumbers() const noexcept { return false; }
+    void LazyNumber(string_view, Type) {}
+};
+
+inline static bool isJsonSpace(char c) noexcept {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline static bool isJsonDelim(char c) noexcept {
+    return isJsonSpace(c) || c == ',' || c == ']' || c == '}' || c == ':' || c == '/' || c == '"';
+}
+
+static Type jsonType(char c) noexcept {
+    switch (c) {
+    case '{': return t_object;
+    case '[': return t_array;
+    case '"': return t_string;
+    case 't': case 'f': return t_boolean;
+    case 'n': return t_null;
+    default: return t_number;
+    }
+}
+
+static Type msgpackType(uint8_t head) noexcept {
+    if (head <= 0x7f || head >= 0xe0) return t_number;
+    if (head <= 0x8f) return t_object;
+    if (head <= 0x9f) return t_array;
+    if (head <= 0xbf) return t_string;
+    switch (head) {
+    case 0xc0: return t_null;
+    case 0xc2: case 0xc3: return t_boolean;
+    case 0xc4: case 0xc5: case 0xc6: case 0xc7: case 0xc8: case 0xc9:
+    case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8: return t_binary;
+    case 0xd9: case 0xda: case 0xdb: return t_string;
+    case 0xdc: case 0xdd: return t_array;
+    case 0xde: case 0xdf: return t_object;
+    case 0xc1: return t_discarded;
+    default: return t_number;
+    }
+}
+
+}
+
+struct TokenReader::Impl {
+    Arena& alloc;
+    ParseSettings params;
+    bool msgpack;
+    const char* begin;
+    const char* ptr;
+    const char* end;
+    //! json: nothing was read from container yet (1/0), msgpack: items left in it
+    ArenaVector<size_t> levels;
+
+    Impl(JsonView raw, Arena& alloc, ParseSettings const& params) :
+        alloc(alloc), params(params), levels(alloc)
+    {
+        auto data = raw.GetRaw();
+        msgpack = raw.GetRawFormat() == RawFormat::msgpack;
+        begin = ptr = data.data();
+        end = begin + data.size();
+        this->params.rawKeys = nullptr;
+        this->params.rawKeysCount = 0;
+    }
+
+    [[noreturn]] void fail(const char* msg, const char* at) {
+        auto offs = size_t(at - begin);
+        ParsingError err(msgpack
+            ? "msgpack parse error: " + std::string(msg) + " @" + std::to_string(offs)
+            : msg + atOffset({begin, size_t(end - begin)}, offs));
+        err.position = offs;
+        throw std::move(err);
+    }
+
+    void enter() {
+        if (meta_Unlikely(levels.size() == params.maxDepth)) {
+            throw DepthError{};
+        }
+    }
+
+    // Json
+
+    meta_alwaysInline void skipSpace() {
+        if (meta_Likely(ptr != end && uint8_t(*ptr) > ' ' && *ptr != '/')) {
+            return;
+        }
+        skipSpaceSlow();
+    }
+
+    void skipSpaceSlow() {
+        while (ptr != end) {
+            if (isJsonSpace(*ptr)) {
+                ++ptr;
+            } else if (*ptr == '/' && end - ptr > 1 && ptr[1] == '/') {
+                while (ptr != end && *ptr != '\n') ++ptr;
+            } else if (*ptr == '/' && end - ptr > 1 && ptr[1] == '*') {
+                auto close = string_view{ptr + 2, size_t(end - ptr - 2)}.find("*/");
+                if (close == string_view::npos) {
+                    fail("Invalid value.", ptr);
+                }
+                ptr += close + 4;
+            } else {
+                break;
+            }
+        }
+    }
+
+    meta_alwaysInline char next(const char* err) {
+        skipSpace();
+        if (meta_Unlikely(ptr == end)) {
+            fail(err, ptr);
+        }
+        return *ptr;
+    }
+
+    unsigned readHex(const char* p) {
+        if (meta_Unlikely(end - p < 4)) {
+            fail("Incorrect hex digit after \\u escape in string.", p);
+        }
+        unsigned res = 0;
+        for (int i = 0; i < 4; ++i) {
+            auto v = hexValue(p[i]);
+            if (meta_Unlikely(v < 0)) {
+                fail("Incorrect hex digit after \\u escape in string.", p + i);
+            }
+            res = res << 4 | unsigned(v);
+        }
+        return res;
+    }
+
+    // ptr points to opening quote. Escaped strings are decoded into alloc
+    string_view string() {
+        const char* q = ptr;
+        const char* src = findStringSpecial(q + 1, end);
+        if (meta_Likely(src != end && *src == '"')) {
+            ptr = src + 1;
+            return {q + 1, size_t(src - q - 1)};
+        }
+        // decoded string is never longer than escaped one
+        auto close = src;
+        while (close != end && *close != '"') {
+            if (*close == '\\' && end - close > 1) {
+                close++;
+            }
+            close = findStringSpecial(close + 1, end);
+        }
+        char* const start = static_cast<char*>(alloc(size_t(close - q), 1));
+        char* dst = start;
+        memcpy(dst, q + 1, size_t(src - q - 1));
+        dst += src - q - 1;
+        for (;;) {
+            if (meta_Unlikely(src == end)) {
+                fail("Missing a closing quotation mark in string.", q);
+            }
+            if (*src == '"') {
+                ptr = src + 1;
+                return {start, size_t(dst - start)};
+            }
+            if (meta_Unlikely(*src != '\\')) {
+                fail("Invalid encoding in string.", src);
+            }
+            if (meta_Unlikely(end - src < 2)) {
+                fail("Missing a closing quotation mark in string.", q);
+            }
+            auto esc = src[1];
+            src += 2;
+            switch (esc) {
+            case '"': *dst++ = '"'; break;
+            case '\\': *dst++ = '\\'; break;
+            case '/': *dst++ = '/'; break;
+            case 'b': *dst++ = '\b'; break;
+            case 'f': *dst++ = '\f'; break;
+            case 'n': *dst++ = '\n'; break;
+            case 'r': *dst++ = '\r'; break;
+            case 't': *dst++ = '\t'; break;
+            case 'u': {
+                auto cp = readHex(src);
+                src += 4;
+                if (meta_Unlikely(cp >= 0xD800 && cp <= 0xDFFF)) {
+                    if (meta_Unlikely(cp > 0xDBFF
+                                      || end - src < 2 || src[0] != '\\' || src[1] != 'u')) {
+                        fail("The surrogate pair in string is invalid.", src);
+                    }
+                    auto low = readHex(src + 2);
+                    if (meta_Unlikely(low < 0xDC00 || low > 0xDFFF)) {
+                        fail("The surrogate pair in string is invalid.", src);
+                    }
+                    src += 6;
+                    cp = (((cp - 0xD800) << 10) | (low - 0xDC00)) + 0x10000;
+                }
+                dst = writeUtf8(dst, cp);
+                break;
+            }
+            default:
+                fail("Invalid escape character in string.", src - 1);
+            }
+            auto next = findStringSpecial(src, end);
+            memcpy(dst, src, size_t(next - src));
+            dst += next - src;
+            src = next;
+        }
+    }
+
+    JsonView jsonScalar() {
+        auto start = ptr;
+        while (ptr != end && !isJsonDelim(*ptr)) ++ptr;
+        if (meta_Unlikely(start == ptr)) {
+            fail("Invalid value.", start);
+        }
+        ScalarSink sink;
+        const char* errAt;
+        if (auto err = emitScalar(sink, start, ptr, errAt)) {
+            fail(err, errAt);
+        }
+        return sink.result;
+    }
+
+    bool jsonNext(bool object) {
+        auto closer = object ? '}' : ']';
+        auto err = object
+                       ? "Missing a comma or '}' after an object member."
+                       : "Missing a comma or ']' after an array element.";
+        auto c = next(err);
+        if (std::exchange(levels.back(), 0)) {
+            if (c == closer) {
+                ++ptr;
+                levels.pop_back();
+                return false;
+            }
+            return true;
+        }
+        if (c == closer) {
+            ++ptr;
+            levels.pop_back();
+            return false;
+        }
+        if (meta_Unlikely(c != ',')) {
+            fail(err, ptr);
+        }
+        ++ptr;
+        // trailing comma
+        if (next(err) == closer) {
+            ++ptr;
+            levels.pop_back();
+            return false;
+        }
+        return true;
+    }
+
+    // MsgPack
+
+    template<typename SzT>
+    size_t length() {
+        if (meta_Unlikely(size_t(end - ptr) < sizeof(SzT))) {
+            fail("unexpected eof", end);
+        }
+        SzT res = 0;
+        for (size_t i = 0; i < sizeof(SzT); ++i) {
+            res = SzT(res << 8) | SzT(uint8_t(*ptr++));
+        }
+        return res;
+    }
+
+    size_t containerHeader() {
+        auto head = uint8_t(*ptr++);
+        switch (head) {
+        case 0xdc: case 0xde: return length<uint16_t>();
+        case 0xdd: case 0xdf: return length<uint32_t>();
+        default: return head & 0b1111;
+        }
+    }
+
+    template<typename T>
+    JsonView trivial() {
+        if (meta_Unlikely(size_t(end - ptr) < sizeof(T))) {
+            fail("unexpected eof", end);
+        }
+        uint_for_t<T> bits = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            bits = uint_for_t<T>(bits << 8) | uint8_t(*ptr++);
+        }
+        T res;
+        memcpy(&res, &bits, sizeof(T));
+        return JsonView(res);
+    }
+
+    JsonView str(size_t len) {
+        if (meta_Unlikely(size_t(end - ptr) < len)) {
+            fail("unexpected eof", end);
+        }
+        auto res = string_view{ptr, len};
+        ptr += len;
+        return res;
+    }
+
+    // most common scalars are decoded here, everything else by ParseMsgPack()
+    JsonView msgpackValue() {
+        if (meta_Unlikely(ptr == end)) {
+            fail("unexpected eof", end);
+        }
+        auto head = uint8_t(*ptr);
+        if (head <= 0x7f) {
+            ptr++;
+            return JsonView(head);
+        } else if (head >= 0xe0) {
+            ptr++;
+            return JsonView(int8_t(head));
+        } else if (head >= 0xa0 && head <= 0xbf) {
+            ptr++;
+            return str(head & 0b11111);
+        }
+        switch (head) {
+        case 0xc0: ptr++; return JsonView(nullptr);
+        case 0xc2: ptr++; return JsonView(false);
+        case 0xc3: ptr++; return JsonView(true);
+        case 0xcc: ptr++; return trivial<uint8_t>();
+        case 0xcd: ptr++; return trivial<uint16_t>();
+        case 0xce: ptr++; return trivial<uint32_t>();
+        case 0xcf: ptr++; return trivial<uint64_t>();
+        case 0xd0: ptr++; return trivial<int8_t>();
+        case 0xd1: ptr++; return trivial<int16_t>();
+        case 0xd2: ptr++; return trivial<int32_t>();
+        case 0xd3: ptr++; return trivial<int64_t>();
+        case 0xca: ptr++; return trivial<float>();
+        case 0xcb: ptr++; return trivial<double>();
+        case 0xd9: ptr++; return str(length<uint8_t>());
+        case 0xda: ptr++; return str(length<uint16_t>());
+        case 0xdb: ptr++; return str(length<uint32_t>());
+        default: break;
+        }
+        auto params = this->params;
+        params.maxDepth -= unsigned(levels.size());
+        try {
+            auto res = ParseMsgPackInPlace({ptr, size_t(end - ptr)}, alloc, params);
+            ptr += res.consumed;
+            return res.result;
+        } catch (ParsingError& e) {
+            e.position += size_t(ptr - begin);
+            throw;
+        }
+    }
+};
+
+TokenReader::TokenReader(JsonView raw, Arena& alloc, ParseSettings params) :
+    d(new (alloc(sizeof(Impl), alignof(Impl))) Impl(raw, alloc, params))
+{}
+
+TokenReader::~TokenReader() {
+    d->~Impl();
+}
+
+Type TokenReader::Peek() {
+    if (d->msgpack) {
+        if (meta_Unlikely(d->ptr == d->end)) {
+            d->fail("unexpected eof", d->end);
+        }
+        return msgpackType(uint8_t(*d->ptr));
+    }
+    return jsonType(d->next("Invalid value."));
+}
+
+JsonView TokenReader::Value() {
+    if (d->msgpack) {
+        return d->msgpackValue();
+    }
+    switch (d->next("Invalid value.")) {
+    case '"': return d->string();
+    case '{': case '[': {
+        auto start = d->ptr;
+        Skip();
+        auto params = d->params;
+        params.maxDepth -= unsigned(d->levels.size());
+        return ParseJsonInPlace(string_view{start, size_t(d->ptr - start)}, d->alloc, params);
+    }
+    default: return d->jsonScalar();
+    }
+}
+
+void TokenReader::Skip() {
+    switch (Peek()) {
+    case t_object: {
+        EnterObject();
+        string_view key;
+        while (NextKey(key)) {
+            Skip();
+        }
+        break;
+    }
+    case t_array: {
+        EnterArray();
+        while (NextItem()) {
+            Skip();
+        }
+        break;
+    }
+    default: {
+        (void)Value();
+    }
+    }
+}
+
+void TokenReader::EnterObject() {
+    if (meta_Unlikely(Peek() != t_object)) {
+        d->fail(d->msgpack ? "unexpected type" : "Invalid value.", d->ptr);
+    }
+    d->enter();
+    if (d->msgpack) {
+        d->levels.push_back(d->containerHeader());
+    } else {
+        d->ptr++;
+        d->levels.push_back(1);
+    }
+}
+
+void TokenReader::EnterArray() {
+    if (meta_Unlikely(Peek() != t_array)) {
+        d->fail(d->msgpack ? "unexpected type" : "Invalid value.", d->ptr);
+    }
+    d->enter();
+    if (d->msgpack) {
+        d->levels.push_back(d->containerHeader());
+    } else {
+        d->ptr++;
+        d->levels.push_back(1);
+    }
+}
+
+bool TokenReader::NextKey(string_view& key) {
+    if (d->msgpack) {
+        if (!d->levels.back()) {
+            d->levels.pop_back();
+            return false;
+        }
+        d->levels.back()--;
+        auto at = d->ptr;
+        auto k = d->msgpackValue();
+        if (meta_Unlikely(!k.Is(t_string))) {
+            d->fail("keys must be string", at);
+        }
+        key = k.GetStringUnsafe();
+        return true;
+    }
+    if (!d->jsonNext(true)) {
+        return false;
+    }
+    if (meta_Unlikely(*d->ptr != '"')) {
+        d->fail("Missing a name for object member.", d->ptr);
+    }
+    key = d->string();
+    if (meta_Unlikely(d->next("Missing a colon after a name of object member.") != ':')) {
+        d->fail("Missing a colon after a name of object member.", d->ptr);
+    }
+    d->ptr++;
+    return true;
+}
+
+bool TokenReader::NextItem() {
+    if (d->msgpack) {
+        if (!d->levels.back()) {
+            d->levels.pop_back();
+            return false;
+        }
+        d->levels.back()--;
+        return true;
+    }
+    return d->jsonNext(false);
+}
+
+void TokenReader::Finish() {
+    if (!d->msgpack) {
+        d->skipSpace();
+    }
+    if (meta_Unlikely(d->ptr != d->end)) {
+        d->fail(d->msgpack ? "trailing data" : "The document root must not be followed by other values.", d->ptr);
+    }
+}
+
+Type TokenReader::PeekType(JsonView src) noexcept {
+    if (!src.Is(t_raw)) {
+        return t_null;
+    }
+    auto data = src.GetRaw();
+    if (src.GetRawFormat() == RawFormat::msgpack) {
+        return data.empty() ? t_null : msgpackType(uint8_t(data[0]));
+    }
+    for (auto c: data) {
+        if (!isJsonSpace(c)) {
+            return jsonType(c);
+        }
+    }
+    return t_null;
+}
@@ -189,6 +189,17 @@ void rpcxx::Server::Unregister(std::string_view method) {
     }
 }
 
+static void materializeParams(Request& req) {
+    if (meta_Likely(!req.params.Is(jv::t_raw))) {
+        return;
+    }
+    try {
+        req.params = Materialize(req.params, req.alloc);
+    } catch (jv::ParsingError& e) {
+        throw RpcException(string{"Invalid params: "} + e.what(), ErrorCode::parse);
+    }
+}
+
 void Server::DoHandleNotify(Request& req) try
 {
     auto& alloc = req.alloc;
@@ -198,6 +209,9 @@ void Server::DoHandleNotify(Request& req) try
     defer revert([&]{
         d->current = d->fallbackCtx;
     });
+    if (!d->selfMiddlewares.empty()) {
+        materializeParams(req);
+    }
     runMiddlewares(req);
     auto found = d->calls.find(req.method.name);
     if (found != d->calls.end()) {
@@ -216,8 +230,13 @@ void Server::DoHandle(Request& req, Promise<JsonView> cb) noexcept try
     defer revert([&]{
         d->current = d->fallbackCtx;
     });
+    // registered calls read raw params directly (see doCall())
+    if (!d->selfMiddlewares.empty()) {
+        materializeParams(req);
+    }
     runMiddlewares(req);
     if (req.method.name.substr(0, 4) == "rpc.") {
+        materializeParams(req);
         handleExtension(ctx);
         return;
     }
@@ -225,6 +244,7 @@ void Server::DoHandle(Request& req, Promise<JsonView> cb) noexcept try
     if (found != d->calls.end()) {
         found->second(ctx);
     } else if (d->fallback) {
+        materializeParams(req);
         ctx.cb((*d->fallback)(req, alloc));
     } else {
         JsonPair data[] = {
@@ -257,24 +277,26 @@ void rpcxx::Server::validateRequest(const string *names, unsigned nargs, CallCtx
     } else if (meta_Unlikely(!ctx.IsMethodCall())) {
         throw RpcException("Expected a method call, called as notify", ErrorCode::invalid_request);
     }
+    auto& params = ctx.req.params;
+    auto type = params.Is(jv::t_raw) ? jv::TokenReader::PeekType(params) : params.GetType();
     if (names) {
-        if (!ctx.req.params.Is(jv::t_object)) {
+        if (type != jv::t_object) {
             auto toPrint = MakeArrayOf(nargs, ctx.alloc);
             for (auto i = 0u; i < nargs; ++i) {
                 toPrint[i] = JsonView{names[i]};
             }
             JsonPair data[] = {
                 {"params_count", nargs},
-                {"was_type", ctx.req.params.GetTypeName()},
+                {"was_type", JsonView::PrintType(type)},
                 {"params_names", JsonView{toPrint, nargs}}
             };
             throw RpcException("Method expected named params", ErrorCode::invalid_params, Json(data));
         }
     } else if (nargs) {
-        if (!ctx.req.params.Is(jv::t_array)) {
+        if (type != jv::t_array) {
             JsonPair data[] = {
                 {"params_count", nargs},
-                {"was_type", ctx.req.params.GetTypeName()}
+                {"was_type", JsonView::PrintType(type)}
             };
             throw RpcException("Method expected positional params", ErrorCode::invalid_params, Json(data));
         }
@@ -48,12 +48,40 @@ struct IAsyncTransport::Impl {
     rc::Weak<IHandler> handler = nullptr;
     steady_clock::time_point last = steady_clock::now();
     rc::Strong<StoppableExecutor> exec = new StoppableExecutor;
+    //! Rewound after each Receive(): its blocks (up to spare limit) stay warm for the next message
+    DefaultArena<0> alloc;
 
     ~Impl() {
         pending.clear();
         exec->Stop();
     }
 
+    void receive(IAsyncTransport* self, JsonView msg, ContextPtr ctx) {
+        if (msg.Is(t_array)) {
+            if (meta_Unlikely(msg.Array(false).size() == 0)) {
+                throw RpcException("Empty batch array", ErrorCode::invalid_request);
+            }
+            switch (proto) {
+            case Protocol::json_v2_compliant:
+                return handleBatch<Protocol::json_v2_compliant>(self, msg, ctx, alloc);
+            case Protocol::json_v2_minified:
+                return handleBatch<Protocol::json_v2_minified>(self, msg, ctx, alloc);
+            }
+        } else if (meta_Unlikely(!msg.Is(jv::t_object))) {
+            JsonPair data[] = {{"was_type", msg.GetTypeName()}};
+            throw RpcException("Request/Responce should be an array or object",
+                               ErrorCode::invalid_request,
+                               jv::Json(data));
+        } else {
+            switch (proto) {
+            case Protocol::json_v2_compliant:
+                return handle<Protocol::json_v2_compliant>(self, msg, ctx, alloc);
+            case Protocol::json_v2_minified:
+                return handle<Protocol::json_v2_minified>(self, msg, ctx, alloc);
+            }
+        }
+    }
+
     template<typename Fn>
     void wrapNotif(string_view method, JsonView params, Fn f) {
         if (proto == Protocol::json_v2_compliant) {
@@ -295,6 +323,16 @@ void IAsyncTransport::TimeoutHappened(string_view method, Promise<JsonView> &tar
     target(FutureError(string{method} + ": Timeout Error"));
 }
 
+void IAsyncTransport::SetArenaLimit(size_t bytes) noexcept
+{
+    d->alloc.SetLimit(bytes);
+}
+
+void IAsyncTransport::OnReceiveStats(JsonView, ArenaStats const&) noexcept
+{
+
+}
+
 void IAsyncTransport::NoServerFound()
 {
     throw RpcException("Server not registered", ErrorCode::internal);
@@ -375,30 +413,16 @@ void IAsyncTransport::CheckTimeouts()
 
 void IAsyncTransport::Receive(JsonView msg, ContextPtr ctx)
 {
-    DefaultArena alloc;
-    if (msg.Is(t_array)) {
-        if (meta_Unlikely(msg.Array(false).size() == 0)) {
-            throw RpcException("Empty batch array", ErrorCode::invalid_request);
-        }
-        switch (d->proto) {
-        case Protocol::json_v2_compliant:
-            return d->handleBatch<Protocol::json_v2_compliant>(this, msg, ctx, alloc);
-        case Protocol::json_v2_minified:
-            return d->handleBatch<Protocol::json_v2_minified>(this, msg, ctx, alloc);
-        }
-    } else if (meta_Unlikely(!msg.Is(jv::t_object))) {
-        JsonPair data[] = {{"was_type", msg.GetTypeName()}};
-        throw RpcException("Request/Responce should be an array or object",
-                           ErrorCode::invalid_request,
-                           jv::Json(data));
-    } else {
-        switch (d->proto) {
-        case Protocol::json_v2_compliant:
-            return d->handle<Protocol::json_v2_compliant>(this, msg, ctx, alloc);
-        case Protocol::json_v2_minified:
-            return d->handle<Protocol::json_v2_minified>(this, msg, ctx, alloc);
-        }
+    // may be nested, if handler gets reply synchronously
+    ArenaScope scope(d->alloc);
+    auto before = d->alloc.Stats();
+    try {
+        d->receive(this, msg, std::move(ctx));
+    } catch (...) {
+        OnReceiveStats(msg, d->alloc.Stats().Since(before));
+        throw;
     }
+    OnReceiveStats(msg, d->alloc.Stats().Since(before));
 }
 
 void IAsyncTransport::Receive(JsonView msg)
@@ -23,43 +23,187 @@ SOFTWARE.
 */
 
 #include "rpcxx/rpcxx.hpp"
+#include "json_view/parallel.hpp"
 #include <benchmark/benchmark.h>
 #include "json_samples.hpp"
+#include <numeric>
+#include <random>
 
 using namespace rpcxx;
 
+static std::string WideObjectSample(unsigned keys, bool sorted)
+{
+    std::vector<unsigned> order(keys);
+    std::iota(order.begin(), order.end(), 0u);
+    if (!sorted) {
+        std::shuffle(order.begin(), order.end(), std::mt19937{keys});
+    }
+    std::string result = "{";
+    for (auto i: order) {
+        auto num = std::to_string(i);
+        result += "\"key_" + std::string(8 - num.size(), '0') + num + "\": " + num + ",";
+    }
+    result.back() = '}';
+    return result;
+}
+
+//! Rows of float-heavy records
+static std::string NumericSample(unsigned rows)
+{
+    std::mt19937 gen{rows};
+    std::uniform_real_distribution<double> dist(-1e6, 1e6);
+    std::string result = "[";
+    for (auto i = 0u; i < rows; ++i) {
+        result += "{\"id\": " + std::to_string(i);
+        for (auto field: {"x", "y", "z", "vx", "vy", "vz"}) {
+            result += ", \"" + std::string{field} + "\": " + std::to_string(dist(gen));
+        }
+        result += "},";
+    }
+    result.back() = ']';
+    return result;
+}
+
+static const std::string Wide1k = WideObjectSample(1000, false);
+static const std::string Wide10k = WideObjectSample(10000, false);
+static const std::string Wide10kSorted = WideObjectSample(10000, true);
+static const std::string Wide10kMsgPack = Json::Parse(Wide10k)->DumpMsgPack();
+static const std::string BigRequest =
+    R"({"jsonrpc": "2.0", "id": 1, "method": "big", "params": )" + std::string{BigSample} + "}";
+static const std::string BigRequestMsgPack = Json::Parse(BigRequest)->DumpMsgPack();
+static const std::string Numeric1k = NumericSample(1000);
+static const std::string BigBatch = [] {
+    std::string batch = "[";
+    for (auto i = 0; i < 200; ++i) {
+        batch += BigRequest + ",";
+    }
+    batch.back() = ']';
+    return batch;
+}();
+
+//! Reports how much memory parsers take from arena
+struct CountingArena final : Arena {
+    DefaultArena<> inner;
+    size_t used = 0;
+protected:
+    void* DoAllocate(size_t size, size_t align) override {
+        used += size;
+        return inner.Allocate(size, align);
+    }
+};
+
+//! Throughput is of output bytes, so that runs of different writers may be compared directly
 static void Dump(benchmark::State& state, string_view sample)
 {
     auto json = Json::Parse(sample);
+    auto size = json->Dump().size();
     for (auto _: state) {
         benchmark::DoNotOptimize(json->Dump());
     }
+    state.SetBytesProcessed(int64_t(state.iterations() * size));
 }
 BENCHMARK_CAPTURE(Dump, books, BooksSample);
 BENCHMARK_CAPTURE(Dump, big, BigSample);
 BENCHMARK_CAPTURE(Dump, rpc, RPCSample);
 
+//! Length-prefixed frame: dump into growing buffer and copy vs size pre-pass and exact dump
+static void DumpFrame(benchmark::State& state, string_view sample, bool exact)
+{
+    auto json = Json::Parse(sample);
+    for (auto _: state) {
+        std::string frame;
+        if (exact) {
+            auto size = MsgPackSize(json.View());
+            frame.resize(4 + size);
+            memcpy(frame.data(), &size, 4);
+            DumpMsgPackTo(frame.data() + 4, json.View());
+        } else {
+            auto body = json->DumpMsgPack();
+            auto size = body.size();
+            frame.resize(4 + size);
+            memcpy(frame.data(), &size, 4);
+            memcpy(frame.data() + 4, body.data(), size);
+        }
+        benchmark::DoNotOptimize(frame);
+    }
+}
+BENCHMARK_CAPTURE(DumpFrame, big_copy, BigSample, false);
+BENCHMARK_CAPTURE(DumpFrame, big_exact, BigSample, true);
+BENCHMARK_CAPTURE(DumpFrame, rpc_copy, RPCSample, false);
+BENCHMARK_CAPTURE(DumpFrame, rpc_exact, RPCSample, true);
+
+//! Response with big binary payload: copied into output vs referenced by segment
+static void DumpBlob(benchmark::State& state, bool segmented)
+{
+    std::string blob(1 << 20, 'x');
+    DefaultArena alloc;
+    auto result = MakeObjectOf(2, alloc);
+    result[0] = {"data", JsonView::Binary(blob)};
+    result[1] = {"name", "blob"};
+    auto msg = MakeObjectOf(3, alloc);
+    msg[0] = {"id", 1};
+    msg[1] = {"jsonrpc", "2.0"};
+    msg[2] = {"result", JsonView(result, 2)};
+    auto json = JsonView(msg, 3);
+    for (auto _: state) {
+        if (segmented) {
+            membuff::SegmentedOut out;
+            DumpMsgPackInto(out, json);
+            benchmark::DoNotOptimize(out.Segments());
+        } else {
+            membuff::StringOut out;
+            DumpMsgPackInto(out, json);
+            benchmark::DoNotOptimize(out.Consume());
+        }
+    }
+}
+BENCHMARK_CAPTURE(DumpBlob, copy, false);
+BENCHMARK_CAPTURE(DumpBlob, segmented, true);
+
+//! Deep copy of parsed DOM (e.g. keeping request past its arena)
+static void CopyDom(benchmark::State& state, string_view sample)
+{
+    DefaultArena src;
+    auto json = ParseJson(sample, src);
+    size_t used = 0;
+    for (auto _: state) {
+        CountingArena alloc;
+        benchmark::DoNotOptimize(Copy(json, alloc));
+        used = alloc.used;
+    }
+    state.counters["arena_bytes"] = double(used);
+}
+BENCHMARK_CAPTURE(CopyDom, books, BooksSample);
+BENCHMARK_CAPTURE(CopyDom, big, BigSample);
+BENCHMARK_CAPTURE(CopyDom, rpc, RPCSample);
+
 static void Parse(benchmark::State& state, string_view sample)
 {
+    size_t used = 0;
     for (auto _: state) {
-        DefaultArena alloc;
+        CountingArena alloc;
         try {
             benchmark::DoNotOptimize(ParseJson(sample, alloc));
         } catch (...) {}
+        used = alloc.used;
     }
+    state.counters["arena_bytes"] = double(used);
 }
 
 static void ParseInSitu(benchmark::State& state, std::string_view sample)
 {
     std::string orig{sample};
     std::string curr = orig;
+    size_t used = 0;
     for (auto _: state) {
         std::string curr = orig;
-        DefaultArena alloc;
+        CountingArena alloc;
         try {
             benchmark::DoNotOptimize(ParseJsonInPlace(curr.data(), curr.size(), alloc));
         } catch (...) {}
+        used = alloc.used;
     }
+    state.counters["arena_bytes"] = double(used);
 }
 
 BENCHMARK_CAPTURE(Parse, books, BooksSample);
@@ -68,6 +212,9 @@ BENCHMARK_CAPTURE(Parse, rpc, RPCSample);
 BENCHMARK_CAPTURE(Parse, rpc_mini, MinifiedRPCSample);
 BENCHMARK_CAPTURE(Parse, early_fail, EarlyFailSample);
 BENCHMARK_CAPTURE(Parse, late_fail, LateFailSample);
+BENCHMARK_CAPTURE(Parse, wide_1k, Wide1k);
+BENCHMARK_CAPTURE(Parse, wide_10k, Wide10k);
+BENCHMARK_CAPTURE(Parse, wide_10k_sorted, Wide10kSorted);
 
 BENCHMARK_CAPTURE(ParseInSitu, books, BooksSample);
 BENCHMARK_CAPTURE(ParseInSitu, big, BigSample);
@@ -76,14 +223,154 @@ BENCHMARK_CAPTURE(ParseInSitu, rpc_mini, MinifiedRPCSample);
 BENCHMARK_CAPTURE(ParseInSitu, early_fail, EarlyFailSample);
 BENCHMARK_CAPTURE(ParseInSitu, late_fail, LateFailSample);
 
-static void Parse_MsgPack(benchmark::State& state, const void* data, size_t len) {
+static void ParseSimd(benchmark::State& state, string_view sample)
+{
+    ParseSettings opts;
+    opts.backend = JsonBackend::simd;
+    size_t used = 0;
+    for (auto _: state) {
+        CountingArena alloc;
+        try {
+            benchmark::DoNotOptimize(ParseJson(sample, alloc, opts));
+        } catch (...) {}
+        used = alloc.used;
+    }
+    state.counters["arena_bytes"] = double(used);
+}
+
+BENCHMARK_CAPTURE(ParseSimd, books, BooksSample);
+BENCHMARK_CAPTURE(ParseSimd, big, BigSample);
+BENCHMARK_CAPTURE(ParseSimd, rpc, RPCSample);
+BENCHMARK_CAPTURE(ParseSimd, rpc_mini, MinifiedRPCSample);
+BENCHMARK_CAPTURE(ParseSimd, early_fail, EarlyFailSample);
+BENCHMARK_CAPTURE(ParseSimd, late_fail, LateFailSample);
+BENCHMARK_CAPTURE(ParseSimd, wide_10k, Wide10k);
+BENCHMARK_CAPTURE(ParseSimd, big_request, BigRequest);
+
+//! Input is not copied, only escaped strings are decoded into arena
+static void ParseBorrowed(benchmark::State& state, string_view sample)
+{
+    size_t used = 0;
+    for (auto _: state) {
+        CountingArena alloc;
+        benchmark::DoNotOptimize(ParseJsonInPlace(sample, alloc));
+        used = alloc.used;
+    }
+    state.counters["arena_bytes"] = double(used);
+}
+
+BENCHMARK_CAPTURE(ParseBorrowed, books, BooksSample);
+BENCHMARK_CAPTURE(ParseBorrowed, big, BigSample);
+BENCHMARK_CAPTURE(ParseBorrowed, rpc, RPCSample);
+BENCHMARK_CAPTURE(ParseBorrowed, big_request, BigRequest);
+
+//! Elements of top-level array are parsed on state.range(0) threads
+static void ParseParallel(benchmark::State& state)
+{
+    ParallelParser parser(unsigned(state.range(0)));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(parser.ParseJson(BigBatch));
+    }
+}
+
+BENCHMARK(ParseParallel)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+//! Only ids are read: with lazy numbers other fields are never converted
+static void ParseNumbers(benchmark::State& state, bool lazy)
+{
+    ParseSettings opts;
+    opts.backend = JsonBackend::simd;
+    opts.lazyNumbers = lazy;
     for (auto _: state) {
         DefaultArena alloc;
-        benchmark::DoNotOptimize(ParseMsgPackInPlace(data, len, alloc));
+        uint64_t sum = 0;
+        for (auto row: ParseJson(Numeric1k, alloc, opts).Array()) {
+            sum += row["id"].Get<uint64_t>();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+BENCHMARK_CAPTURE(ParseNumbers, eager, false);
+BENCHMARK_CAPTURE(ParseNumbers, lazy, true);
+
+//! Only envelope is parsed, params are kept as raw slice
+static void ParseLazy(benchmark::State& state, string_view sample)
+{
+    auto opts = LazyParseSettings(Protocol::json_v2_compliant);
+    size_t used = 0;
+    for (auto _: state) {
+        CountingArena alloc;
+        benchmark::DoNotOptimize(ParseJson(sample, alloc, opts));
+        used = alloc.used;
     }
+    state.counters["arena_bytes"] = double(used);
+}
+
+BENCHMARK_CAPTURE(ParseLazy, rpc, RPCSample);
+BENCHMARK_CAPTURE(ParseLazy, big_request, BigRequest);
+
+static void ParseStream(benchmark::State& state, string_view sample)
+{
+    constexpr size_t chunk = 4096;
+    size_t used = 0;
+    for (auto _: state) {
+        CountingArena alloc;
+        try {
+            JsonStreamParser parser(alloc);
+            for (size_t i = 0; i < sample.size(); i += chunk) {
+                (void)parser.Feed(sample.substr(i, chunk));
+            }
+            benchmark::DoNotOptimize(parser.Finish());
+        } catch (...) {}
+        used = alloc.used;
+    }
+    state.counters["arena_bytes"] = double(used);
+}
+
+BENCHMARK_CAPTURE(ParseStream, books, BooksSample);
+BENCHMARK_CAPTURE(ParseStream, big, BigSample);
+BENCHMARK_CAPTURE(ParseStream, rpc, RPCSample);
+
+static void Parse_MsgPack(benchmark::State& state, const void* data, size_t len, ParseSettings opts = {}) {
+    size_t used = 0;
+    for (auto _: state) {
+        CountingArena alloc;
+        benchmark::DoNotOptimize(ParseMsgPackInPlace(data, len, alloc, opts));
+        used = alloc.used;
+    }
+    state.counters["arena_bytes"] = double(used);
 }
 BENCHMARK_CAPTURE(Parse_MsgPack, rpc, MsgPackRPC, sizeof(MsgPackRPC));
 BENCHMARK_CAPTURE(Parse_MsgPack, books, MsgPackBooks, sizeof(MsgPackBooks));
+BENCHMARK_CAPTURE(Parse_MsgPack, wide_10k, Wide10kMsgPack.data(), Wide10kMsgPack.size());
+BENCHMARK_CAPTURE(Parse_MsgPack, big_request, BigRequestMsgPack.data(), BigRequestMsgPack.size());
+BENCHMARK_CAPTURE(Parse_MsgPack, big_request_lazy, BigRequestMsgPack.data(), BigRequestMsgPack.size(),
+                  LazyParseSettings(Protocol::json_v2_compliant));
+
+//! Many small messages without framing, as they come from socket
+static void ParseStream_MsgPack(benchmark::State& state, size_t chunk) {
+    std::string stream;
+    for (auto i = 0; i < 100; ++i) {
+        stream.append(reinterpret_cast<const char*>(MsgPackRPC), sizeof(MsgPackRPC));
+    }
+    for (auto _: state) {
+        DefaultArena alloc;
+        MsgPackStreamParser parser(alloc);
+        size_t count = 0;
+        for (size_t i = 0; i < stream.size(); i += chunk) {
+            auto left = string_view{stream}.substr(i, chunk);
+            while (!left.empty()) {
+                auto status = parser.Feed(left);
+                left.remove_prefix(status.consumed);
+                count += status.done;
+            }
+        }
+        benchmark::DoNotOptimize(count);
+    }
+}
+BENCHMARK_CAPTURE(ParseStream_MsgPack, rpc_x100_by_4k, 4096);
+BENCHMARK_CAPTURE(ParseStream_MsgPack, rpc_x100_by_64, 64);
 
 struct TestChild
 {
@@ -142,4 +429,183 @@ static void DeSerialize(benchmark::State& state) {
 }
 BENCHMARK(DeSerialize);
 
+static const std::vector<TestData> testBatch(50, testData);
+static const std::string TestBatchJson = [] {
+    DefaultArena alloc;
+    return JsonView::From(testBatch, alloc).Dump();
+}();
+static const std::string TestBatchMsgPack = [] {
+    DefaultArena alloc;
+    return JsonView::From(testBatch, alloc).DumpMsgPack();
+}();
+
+//! DOM + Convert vs ReadAs() straight from tokens
+static void ReadStruct(benchmark::State& state, string_view sample, RawFormat format, bool dom) {
+    auto raw = JsonView::Raw(sample, format);
+    size_t used = 0;
+    for (auto _: state) {
+        CountingArena alloc;
+        if (dom) {
+            benchmark::DoNotOptimize(Materialize(raw, alloc).Get<std::vector<TestData>>());
+        } else {
+            benchmark::DoNotOptimize(ReadAs<std::vector<TestData>>(raw, alloc));
+        }
+        used = alloc.used;
+    }
+    state.counters["arena_bytes"] = double(used);
+}
+BENCHMARK_CAPTURE(ReadStruct, json_dom, TestBatchJson, RawFormat::json, true);
+BENCHMARK_CAPTURE(ReadStruct, json_direct, TestBatchJson, RawFormat::json, false);
+BENCHMARK_CAPTURE(ReadStruct, msgpack_dom, TestBatchMsgPack, RawFormat::msgpack, true);
+BENCHMARK_CAPTURE(ReadStruct, msgpack_direct, TestBatchMsgPack, RawFormat::msgpack, false);
+
+// Wide structs: fields f000..., declared in reverse order of keys
+#define WIDE_DECL(name) int name = 1;
+#define WIDE_MEMBER(name) MEMBER(#name, &_::name);
+#define WIDE_5(m, p) m(p##4) m(p##3) m(p##2) m(p##1) m(p##0)
+#define WIDE_10(m, p) m(p##9) m(p##8) m(p##7) m(p##6) m(p##5) WIDE_5(m, p)
+#define WIDE_50(m, p) WIDE_10(m, p##4) WIDE_10(m, p##3) WIDE_10(m, p##2) WIDE_10(m, p##1) WIDE_10(m, p##0)
+#define WIDE_500(m, p) WIDE_50(m, p##9) WIDE_50(m, p##8) WIDE_50(m, p##7) WIDE_50(m, p##6) WIDE_50(m, p##5) \
+    WIDE_50(m, p##4) WIDE_50(m, p##3) WIDE_50(m, p##2) WIDE_50(m, p##1) WIDE_50(m, p##0)
+
+struct Wide5 { WIDE_5(WIDE_DECL, f) };
+DESCRIBE("Wide5", Wide5) { WIDE_5(WIDE_MEMBER, f) }
+struct Wide50 { WIDE_50(WIDE_DECL, f) };
+DESCRIBE("Wide50", Wide50) { WIDE_50(WIDE_MEMBER, f) }
+struct Wide500 { WIDE_500(WIDE_DECL, f) };
+DESCRIBE("Wide500", Wide500) { WIDE_500(WIDE_MEMBER, f) }
+
+template<typename T>
+static void SerializeWide(benchmark::State& state) {
+    T value;
+    for (auto _: state) {
+        DefaultArena alloc;
+        benchmark::DoNotOptimize(JsonView::From(value, alloc));
+    }
+}
+BENCHMARK_TEMPLATE(SerializeWide, Wide5);
+BENCHMARK_TEMPLATE(SerializeWide, Wide50);
+BENCHMARK_TEMPLATE(SerializeWide, Wide500);
+
+template<typename T>
+static void DeserializeWide(benchmark::State& state) {
+    DefaultArena alloc;
+    JsonView json = JsonView::From(T{}, alloc);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(json.Get<T>());
+    }
+}
+BENCHMARK_TEMPLATE(DeserializeWide, Wide5);
+BENCHMARK_TEMPLATE(DeserializeWide, Wide50);
+BENCHMARK_TEMPLATE(DeserializeWide, Wide500);
+
+//! JsonView::From() + dump vs Serialize*() straight into output
+static void WriteStruct(benchmark::State& state, RawFormat format, bool dom) {
+    for (auto _: state) {
+        membuff::StringOut out;
+        if (dom) {
+            DefaultArena alloc;
+            auto json = JsonView::From(testBatch, alloc);
+            if (format == RawFormat::msgpack) {
+                DumpMsgPackInto(out, json);
+            } else {
+                DumpJsonInto(out, json);
+            }
+        } else if (format == RawFormat::msgpack) {
+            SerializeMsgPack(out, testBatch);
+        } else {
+            SerializeJson(out, testBatch);
+        }
+        benchmark::DoNotOptimize(out.Consume());
+    }
+}
+BENCHMARK_CAPTURE(WriteStruct, json_dom, RawFormat::json, true);
+BENCHMARK_CAPTURE(WriteStruct, json_direct, RawFormat::json, false);
+BENCHMARK_CAPTURE(WriteStruct, msgpack_dom, RawFormat::msgpack, true);
+BENCHMARK_CAPTURE(WriteStruct, msgpack_direct, RawFormat::msgpack, false);
+
+static const std::vector<double> Telemetry = [] {
+    std::vector<double> result(100000);
+    for (size_t i = 0; i < result.size(); ++i) {
+        result[i] = double(i) * 0.37;
+    }
+    return result;
+}();
+
+static void NumericArray_Get(benchmark::State& state) {
+    DefaultArena alloc;
+    JsonView json = JsonView::From(Telemetry, alloc);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(json.Get<std::vector<double>>());
+    }
+}
+BENCHMARK(NumericArray_Get);
+
+static void NumericArray_Dump(benchmark::State& state, bool direct) {
+    DefaultArena alloc;
+    JsonView json = JsonView::From(Telemetry, alloc);
+    for (auto _: state) {
+        membuff::StringOut out;
+        if (direct) {
+            SerializeMsgPack(out, Telemetry);
+        } else {
+            DumpMsgPackInto(out, json);
+        }
+        benchmark::DoNotOptimize(out.Consume());
+    }
+}
+BENCHMARK_CAPTURE(NumericArray_Dump, dom, false);
+BENCHMARK_CAPTURE(NumericArray_Dump, direct, true);
+
+static void Base64Blob(benchmark::State& state) {
+    Bytes blob(256 * 1024);
+    for (size_t i = 0; i < blob.size(); ++i) {
+        blob[i] = char(i * 31);
+    }
+    auto json = JsonView::Binary(blob.View()).Dump();
+    for (auto _: state) {
+        DefaultArena local;
+        auto parsed = ParseJsonInPlace(string_view{json}, local);
+        benchmark::DoNotOptimize(DecodeBinary(parsed, local).Dump());
+    }
+}
+BENCHMARK(Base64Blob);
+
+//! Arena block policy: 0 - fixed 4KB blocks, 1 - geometric growth, 2 - growth and huge pages
+static ArenaGrowth GrowthMode(int64_t mode) {
+    switch (mode) {
+    case 0: return {4096, 4096, 0};
+    case 1: return {4096, size_t(1) << 20, 0};
+    default: return {};
+    }
+}
+
+static const std::string Numeric200k = NumericSample(200000);
+static const std::vector<TestData> testHugeBatch(100000, testData);
+
+static void ParseMultiMB(benchmark::State& state) {
+    ArenaStats stats;
+    for (auto _: state) {
+        DefaultArena alloc;
+        alloc.SetGrowth(GrowthMode(state.range(0)));
+        benchmark::DoNotOptimize(ParseJsonInPlace(string_view{Numeric200k}, alloc));
+        stats = alloc.Stats();
+    }
+    state.counters["blocks"] = double(stats.blocks);
+    state.SetBytesProcessed(int64_t(state.iterations() * Numeric200k.size()));
+}
+BENCHMARK(ParseMultiMB)->Arg(0)->Arg(1)->Arg(2);
+
+static void SerializeMultiMB(benchmark::State& state) {
+    ArenaStats stats;
+    for (auto _: state) {
+        DefaultArena alloc;
+        alloc.SetGrowth(GrowthMode(state.range(0)));
+        benchmark::DoNotOptimize(JsonView::From(testHugeBatch, alloc));
+        stats = alloc.Stats();
+    }
+    state.counters["blocks"] = double(stats.blocks);
+}
+BENCHMARK(SerializeMultiMB)->Arg(0)->Arg(1)->Arg(2);
+
 BENCHMARK_MAIN();
@@ -23,7 +23,10 @@ SOFTWARE.
 */
 
 #include "rpcxx/rpcxx.hpp"
+#include "json_view/parallel.hpp"
 #include "json_samples.hpp"
+#include <sstream>
+#include <thread>
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 
@@ -113,6 +116,29 @@ TEST_CASE("algos")
         MergePatch(merged, patch.View());
         CHECK(merged.View(alloc)["arr"].Size() == 0);
     }
+    SUBCASE("copy") {
+        struct Counting final : Arena {
+            DefaultArena<> inner;
+            unsigned calls = 0;
+            void* DoAllocate(size_t size, size_t align) override {
+                calls++;
+                return inner.Allocate(size, align);
+            }
+        };
+        DefaultArena src;
+        auto json = ParseJsonInPlace(string_view{BooksSample}, src);
+        for (auto flags: {0u, unsigned(NoCopyStrings)}) {
+            Counting alloc;
+            auto copy = Copy(json, alloc, JV_DEFAULT_DEPTH, flags);
+            CHECK(DeepEqual(copy, json));
+            // whole copy is one block
+            CHECK_EQ(alloc.calls, 1);
+        }
+        Counting alloc;
+        CHECK(Copy(JsonView("lol"), alloc).GetString() == "lol");
+        CHECK(Copy(JsonView(1), alloc).Get<int>() == 1);
+        CHECK_THROWS_AS(Copy(json, alloc, 2), DepthError);
+    }
 }
 
 TEST_CASE("parse json") {
@@ -211,6 +237,238 @@ TEST_CASE("parse json") {
         CHECK(empty["object"].Is(jv::t_object));
         CHECK_EQ(empty["object"].Size(), 0);
     }
+    GIVEN("simd backend") {
+        DefaultArena alloc;
+        ParseSettings simd;
+        simd.backend = JsonBackend::simd;
+        for (string_view sample: {string_view{BooksSample}, string_view{BigSample}, string_view{RPCSample}, string_view{MinifiedRPCSample}}) {
+            auto generic = ParseJson(sample, alloc);
+            auto fast = ParseJson(sample, alloc, simd);
+            CHECK(DeepEqual(generic, fast));
+        }
+        auto json = ParseJson(R"({"a\"b": "\u0416\ud83d\ude00\\", "n": [-1, 2, 1.5, NaN, -Infinity,],})", alloc, simd);
+        CHECK_EQ(json["a\"b"].GetString(), "\xD0\x96\xF0\x9F\x98\x80\\");
+        CHECK(json["n"][0].Is(t_signed));
+        CHECK(json["n"][1].Is(t_unsigned));
+        CHECK(json["n"][2].Is(t_number));
+        CHECK_EQ(json["n"].Size(), 5);
+        // comments are handled by generic backend
+        CHECK_EQ(ParseJson("[1, /* two */ 2]", alloc, simd).Size(), 2);
+        for (auto bad: {"", "[1,2", "{\"a\" 1}", "[1 2]", "01", "\"abc", "\"\\ud800\"", "truex", "1 2"}) {
+            CHECK_THROWS_AS((void)ParseJson(bad, alloc, simd), ParsingError);
+        }
+    }
+    GIVEN("borrowed input") {
+        DefaultArena alloc;
+        const std::string src = R"({"plain": "abc", "esc": "a\nb\u0416", "k\"ey": 1, "arr": ["x", "\t", 1.5]})";
+        const std::string before = src;
+        auto inside = [&](string_view str) {
+            return str.data() >= src.data() && str.data() < src.data() + src.size();
+        };
+        auto json = ParseJsonInPlace(string_view{src}, alloc);
+        CHECK_EQ(src, before);
+        CHECK(DeepEqual(json, ParseJson(src, alloc)));
+        CHECK(inside(json["plain"].GetString()));
+        CHECK(inside(json["arr"][0].GetString()));
+        CHECK_EQ(json["esc"].GetString(), "a\nb\xD0\x96");
+        CHECK_FALSE(inside(json["esc"].GetString()));
+        CHECK_EQ(json["arr"][1].GetString(), "\t");
+        CHECK_EQ(json["k\"ey"].Get<int>(), 1);
+        for (string_view sample: {string_view{BooksSample}, string_view{BigSample}, string_view{RPCSample}}) {
+            CHECK(DeepEqual(ParseJsonInPlace(sample, alloc), ParseJson(sample, alloc)));
+        }
+        CHECK_EQ(ParseJsonInPlace(string_view{"\"\\u0416\""}, alloc).GetString(), "\xD0\x96");
+        // inputs with comments are copied
+        CHECK_EQ(ParseJsonInPlace(string_view{"[1, /* two */ 2]"}, alloc).Size(), 2);
+        for (auto bad: {"[1,2", "\"abc", "\"a\\", "\"\\x\"", "\"\\ud800\""}) {
+            CHECK_THROWS_AS((void)ParseJsonInPlace(string_view{bad}, alloc), ParsingError);
+        }
+    }
+    GIVEN("parallel") {
+        DefaultArena alloc;
+        std::string batch = "[";
+        for (auto i = 0; i < 500; ++i) {
+            batch += std::string{RPCSample} + ", \"s\\n" + std::to_string(i) + "\" ,[" + std::to_string(i) + ", [], {}],\n";
+        }
+        batch += "-1.5]";
+        ParallelParser parser(4);
+        parser.SetMinSize(0);
+        auto expected = ParseJson(batch, alloc);
+        auto json = parser.ParseJson(batch);
+        CHECK_EQ(json.Size(), 1501);
+        CHECK(DeepEqual(json, expected));
+        CHECK_EQ(json[1].GetString(), "s\n0");
+        auto msgpack = DumpMsgPack(expected);
+        auto packed = parser.ParseMsgPack(msgpack);
+        CHECK_EQ(packed.consumed, msgpack.size());
+        CHECK(DeepEqual(packed.result, expected));
+        // not arrays and small inputs are parsed as usual
+        CHECK_EQ(parser.ParseJson(R"({"a": [1, 2]})")["a"].Size(), 2);
+        CHECK_EQ(parser.ParseJson("[]").Size(), 0);
+        CHECK_EQ(parser.ParseJson("[1, 2,]").Size(), 2);
+        // errors are same as with single-threaded parse
+        for (auto bad: {"[1, {\"a\": }, 3]", "[1 2]", "[1, 2", "[,1]", "[[1], 2]]", "[\"abc]"}) {
+            std::string single;
+            try {
+                (void)ParseJson(bad, alloc);
+            } catch (ParsingError& e) {
+                single = e.what();
+            }
+            CHECK_FALSE(single.empty());
+            CHECK_THROWS_AS((void)parser.ParseJson(bad), ParsingError);
+            try {
+                (void)parser.ParseJson(bad);
+            } catch (ParsingError& e) {
+                CHECK_EQ(single, e.what());
+            }
+        }
+        ParseSettings shallow;
+        shallow.maxDepth = 2;
+        CHECK_THROWS_AS((void)parser.ParseJson("[1, [[2]]]", shallow), DepthError);
+    }
+    GIVEN("unsorted keys") {
+        DefaultArena alloc;
+        ParseSettings simd;
+        simd.backend = JsonBackend::simd;
+        string_view raw = R"({"c": 1, "a": 2, "b": 3, "a": 4, "d": {"z": 1, "y": 2}})";
+        for (auto json: {ParseJson(raw, alloc), ParseJson(raw, alloc, simd)}) {
+            CHECK_EQ(json.Size(), 4);
+            CHECK_EQ(json["a"].Get<int>(), 4);
+            CHECK(std::is_sorted(json.Object().begin(), json.Object().end(), KeyLess{}));
+            CHECK(std::is_sorted(json["d"].Object().begin(), json["d"].Object().end(), KeyLess{}));
+        }
+    }
+    GIVEN("raw keys") {
+        DefaultArena alloc;
+        string_view keys[] = {"params", "result"};
+        ParseSettings lazy;
+        lazy.rawKeys = keys;
+        lazy.rawKeysCount = 2;
+        string_view params = R"({"x": [1, {"y": "\"}]"}], "z": null})";
+        auto src = R"({"id": 1, "params": )" + string{params} + R"( , "other": {"params": 1}})";
+        auto json = ParseJson(src, alloc, lazy);
+        CHECK_EQ(json["id"].Get<int>(), 1);
+        CHECK_EQ(json["params"].GetRaw(), params);
+        CHECK(json["other"]["params"].Is(t_unsigned));
+        CHECK(DeepEqual(Materialize(json["params"], alloc), ParseJson(params, alloc)));
+        CHECK(DeepEqual(json, ParseJson(src, alloc)));
+        CHECK(Copy(json, alloc)["params"].Is(t_raw));
+        CHECK(Json(json)["params"].Is(t_raw));
+        CHECK(MutableJson(json)["params"].Is(t_object));
+        auto batch = ParseJson(R"([{"params": [1, 2]}, {"result": "str"  }, 3])", alloc, lazy);
+        CHECK_EQ(batch[0]["params"].GetRaw(), "[1, 2]");
+        CHECK_EQ(batch[1]["result"].GetRaw(), "\"str\"");
+        for (auto bad: {R"({"params": [1, 2}})", R"({"params": })", R"({"params": [1, 2)"}) {
+            CHECK_THROWS_AS((void)ParseJson(bad, alloc, lazy), ParsingError);
+        }
+        // only brackets are checked before materialization
+        auto invalid = ParseJson(R"({"params": [1 2]})", alloc, lazy);
+        CHECK_THROWS_AS((void)Materialize(invalid["params"], alloc), ParsingError);
+        // inputs with comments are parsed fully
+        CHECK(ParseJson(R"({"params": [1, /* two */ 2]})", alloc, lazy)["params"].Is(t_array));
+    }
+    GIVEN("lazy numbers") {
+        DefaultArena alloc;
+        ParseSettings lazy;
+        lazy.lazyNumbers = true;
+        string_view src = R"({"i": -12, "u": 42, "d": 1.25e2, "big": 123456789012345678901, "tiny": 1e-400,
+                             "nan": NaN, "pi": 3.14159265358979323846264338327950288, "arr": [0, -0, 7]})";
+        for (auto backend: {JsonBackend::generic, JsonBackend::simd}) {
+            lazy.backend = backend;
+            auto json = ParseJson(src, alloc, lazy);
+            CHECK(json["i"].Is(t_signed));
+            CHECK(json["i"].HasFlag(f_lazy_number));
+            CHECK_EQ(json["i"].GetNumberText(), "-12");
+            CHECK_EQ(json["i"].Get<int>(), -12);
+            CHECK(json["u"].Is(t_unsigned));
+            CHECK_EQ(json["u"].Get<uint8_t>(), 42);
+            CHECK(json["d"].Is(t_number));
+            CHECK_EQ(json["d"].Get<double>(), 125.);
+            CHECK_EQ(json["pi"].GetNumberText(), "3.14159265358979323846264338327950288");
+            CHECK_EQ(json["pi"].Get<float>(), doctest::Approx(3.14159));
+            // values, which might overflow, are parsed right away
+            CHECK_FALSE(json["big"].HasFlag(f_lazy_number));
+            CHECK(json["big"].Is(t_number));
+            CHECK_EQ(json["tiny"].Get<double>(), 0.);
+            CHECK(std::isnan(json["nan"].Get<double>()));
+            CHECK_THROWS_AS((void)json["i"].Get<unsigned>(), IntRangeError);
+            CHECK_THROWS_AS((void)json["d"].Get<int>(), TypeMissmatch);
+            CHECK(DeepEqual(json, ParseJson(src, alloc)));
+            CHECK(DeepEqual(Copy(json, alloc), json));
+            MutableJson mut(json);
+            CHECK_FALSE(mut.View(alloc)["i"].HasFlag(f_lazy_number));
+            CHECK_EQ(mut.View(alloc)["i"].Get<int>(), -12);
+            CHECK(DeepEqual(ParseMsgPack(DumpMsgPack(json), alloc), json));
+            CHECK_THROWS_AS((void)ParseJson("[1e999]", alloc, lazy), ParsingError);
+        }
+        // stream parser cannot keep slices of chunks
+        JsonStreamParser parser(alloc, lazy);
+        (void)parser.Feed("[1, 2]");
+        CHECK_FALSE(parser.Finish()[0].HasFlag(f_lazy_number));
+    }
+    GIVEN("stream") {
+        DefaultArena alloc;
+        for (size_t chunk: {1, 7, 4096}) {
+            for (string_view sample: {string_view{BooksSample}, string_view{BigSample}, string_view{RPCSample}}) {
+                JsonStreamParser parser(alloc);
+                size_t consumed = 0;
+                for (size_t i = 0; i < sample.size(); i += chunk) {
+                    // chunks do not have to outlive parser
+                    std::string part{sample.substr(i, chunk)};
+                    consumed += parser.Feed(part).consumed;
+                }
+                CHECK_EQ(consumed, sample.size());
+                CHECK(DeepEqual(parser.Finish(), ParseJson(sample, alloc)));
+            }
+        }
+        JsonStreamParser parser(alloc);
+        CHECK_FALSE(parser.Feed(R"({"a": [1, "b)").done);
+        auto status = parser.Feed(R"(c"]} {"next": 1})");
+        CHECK(status.done);
+        CHECK_EQ(status.consumed, 4);
+        CHECK_EQ(parser.Result()["a"][1].GetString(), "bc");
+        JsonStreamParser scalar(alloc);
+        CHECK_FALSE(scalar.Feed("12").done);
+        CHECK_FALSE(scalar.Feed("3").done);
+        CHECK_EQ(scalar.Finish().Get<int>(), 123);
+        JsonStreamParser partial(alloc);
+        (void)partial.Feed("[1, 2");
+        CHECK_THROWS_AS((void)partial.Finish(), ParsingError);
+        std::istringstream stream(R"({"a": 1} /* trailing */ )");
+        CHECK_EQ(ParseJson(stream, alloc)["a"].Get<int>(), 1);
+        std::istringstream garbage(R"({"a": 1} 2)");
+        CHECK_THROWS_AS((void)ParseJson(garbage, alloc), ParsingError);
+        // settings the stream parser lacks are honored by buffering whole input
+        ParseSettings settings;
+        string_view keys[] = {"params"};
+        settings.rawKeys = keys;
+        settings.rawKeysCount = 1;
+        settings.lazyNumbers = true;
+        for (auto backend: {JsonBackend::generic, JsonBackend::simd}) {
+            settings.backend = backend;
+            std::istringstream withSettings(R"({"params": [1, 2], "n": 12})");
+            auto json = ParseJson(withSettings, alloc, settings);
+            CHECK_EQ(json["params"].GetRaw(), "[1, 2]");
+            CHECK(json["n"].HasFlag(f_lazy_number));
+            CHECK_EQ(json["n"].Get<int>(), 12);
+        }
+        // elements of open containers are kept in arena: its limit bounds hostile stream
+        DefaultArena<0> limited;
+        limited.SetLimit(1 << 20);
+        JsonStreamParser open(limited);
+        (void)open.Feed("[");
+        std::string items;
+        for (unsigned i = 0; i < 1000; ++i) {
+            items += "1,";
+        }
+        auto feedAll = [&]{
+            for (unsigned i = 0; i < 1000; ++i) {
+                (void)open.Feed(items);
+            }
+        };
+        CHECK_THROWS_AS(feedAll(), std::bad_alloc);
+        CHECK(limited.Stats().reserved <= (1 << 20));
+    }
     SUBCASE("dump") {
         DefaultArena alloc;
         GIVEN("rpc sample") {
@@ -225,6 +483,64 @@ TEST_CASE("parse json") {
             auto back = ParseJson(serialized, alloc);
             CHECK(DeepEqual(json, back));
         }
+        GIVEN("lazy numbers") {
+            ParseSettings lazy;
+            lazy.lazyNumbers = true;
+            // original text is written as is
+            string_view src = R"([0.10000000000000000000001,-5,1E+2])";
+            CHECK_EQ(DumpJson(ParseJson(src, alloc, lazy)), src);
+        }
+        GIVEN("format") {
+            CHECK_EQ(DumpJson(JsonView(1.0)), "1.0");
+            CHECK_EQ(DumpJson(JsonView(-0.25)), "-0.25");
+            CHECK_EQ(DumpJson(JsonView(1e-7)), "1e-7");
+            CHECK_EQ(DumpJson(JsonView(1.5e300)), "1.5e300");
+            CHECK_EQ(DumpJson(JsonView(std::nan(""))), "null");
+            auto json = ParseJson(R"({"s": "q\"\\\n\u0001/", "a": [1, {}, []]})", alloc);
+            CHECK_EQ(DumpJson(json), R"({"a":[1,{},[]],"s":"q\"\\\n\u0001/"})");
+            CHECK_EQ(DumpJson(json, {true}),
+                     "{\n    \"a\": [\n        1,\n        {},\n        []\n    ],\n"
+                     "    \"s\": \"q\\\"\\\\\\n\\u0001/\"\n}");
+            std::string longStr(5000, 'x');
+            longStr[4000] = '\t';
+            std::string out;
+            membuff::FuncOut small([&](const char* data, size_t size){
+                out.append(data, size);
+            });
+            DumpJsonInto(small, JsonView(longStr));
+            small.Flush();
+            CHECK_EQ(ParseJson(out, alloc).GetString(), longStr);
+        }
+        GIVEN("raw fragments") {
+            string_view cached = R"({"x": [1, 2]})";
+            auto packed = DumpMsgPack(ParseJson(cached, alloc));
+            JsonPair pairs[] = {
+                {"j", JsonView::Raw(cached)},
+                {"m", JsonView::Raw(packed, RawFormat::msgpack)},
+            };
+            JsonView json(pairs, 2);
+            // spliced as is when format matches, transcoded otherwise
+            CHECK_EQ(DumpJson(json), R"({"j":{"x": [1, 2]},"m":{"x":[1,2]}})");
+            auto asMsgPack = DumpMsgPack(json);
+            CHECK(asMsgPack.find(packed) != std::string::npos);
+            CHECK_EQ(asMsgPack.size(), MsgPackSize(json));
+            CHECK(DeepEqual(ParseMsgPack(asMsgPack, alloc), ParseJson(DumpJson(json), alloc)));
+        }
+        GIVEN("size bound") {
+            auto json = ParseJson(BooksSample, alloc);
+            for (bool pretty: {false, true}) {
+                auto dumped = DumpJson(json, {pretty});
+                auto bound = JsonSizeBound(json, {pretty});
+                CHECK(bound >= dumped.size());
+                std::string exact(bound, '\0');
+                auto end = DumpJsonTo(exact.data(), json, {pretty});
+                CHECK_EQ(string_view(exact.data(), size_t(end - exact.data())), dumped);
+            }
+            // exact when there are no doubles
+            auto escaped = ParseJson(R"({"a\n": ["\u0001\"", -123, true, null, {}]})", alloc);
+            CHECK_EQ(JsonSizeBound(escaped), DumpJson(escaped).size());
+            CHECK_EQ(JsonSizeBound(escaped, {true}), DumpJson(escaped, {true}).size());
+        }
     }
 }
 
@@ -278,6 +594,123 @@ void test::Data::Validate(JsonView)
     }
 }
 
+struct TupleLike {
+    int x;
+    std::optional<string> y;
+    int z;
+};
+DESCRIBE("TupleLike", TupleLike, StructAsTuple) {
+    MEMBER("x", &_::x);
+    MEMBER("y", &_::y);
+    MEMBER("z", &_::z, FieldIndex<2>);
+}
+
+struct Loose {
+    int a = 7;
+    std::vector<int> v;
+};
+DESCRIBE("Loose", Loose, SkipMissing) {
+    MEMBER("a", &_::a);
+    MEMBER("v", &_::v);
+}
+
+struct Positive {
+    static void validate(int v) {
+        if (v <= 0) throw std::runtime_error("not positive");
+    }
+};
+
+struct Validated {
+    int a;
+    std::map<string, TupleLike> tuples;
+};
+DESCRIBE("Validated", Validated) {
+    MEMBER("a", &_::a, ValidatedWith<Positive>);
+    MEMBER("tuples", &_::tuples);
+}
+
+struct Unsorted {
+    int zeta;
+    int alpha;
+    std::string mid;
+    int al;
+};
+DESCRIBE("Unsorted", Unsorted) {
+    MEMBER("zeta", &_::zeta);
+    MEMBER("alpha", &_::alpha);
+    MEMBER("mid", &_::mid);
+    MEMBER("al", &_::al);
+}
+
+//! Described, but has own conversion: long string built in arena
+struct Repeated {
+    std::string part;
+    unsigned times;
+};
+DESCRIBE("Repeated", Repeated) {
+    MEMBER("part", &_::part);
+    MEMBER("times", &_::times);
+}
+
+template<>
+struct jv::Convert<Repeated> {
+    static JsonView DoIntoJson(Repeated const& value, Arena& alloc) {
+        auto size = value.part.size() * value.times;
+        auto buff = static_cast<char*>(alloc(size, 1));
+        for (unsigned i = 0; i < value.times; ++i) {
+            ::memcpy(buff + i * value.part.size(), value.part.data(), value.part.size());
+        }
+        return JsonView(string_view{buff, size});
+    }
+};
+
+//! Described, but stored as {"coords": [x, y]} by own conversion
+struct Point {
+    int x;
+    int y;
+};
+DESCRIBE("Point", Point) {
+    MEMBER("x", &_::x);
+    MEMBER("y", &_::y);
+}
+
+template<>
+struct jv::Convert<Point> {
+    static JsonView DoIntoJson(Point const& value, Arena& alloc) {
+        auto coords = MakeArrayOf(2, alloc);
+        coords[0] = JsonView(value.x);
+        coords[1] = JsonView(value.y);
+        auto obj = MakeObjectOf(1, alloc);
+        obj[0] = {"coords", JsonView(coords, 2)};
+        return JsonView(obj, 1);
+    }
+    static void DoFromJson(Point& value, JsonView json, TraceFrame const& frame) {
+        auto coords = json.At("coords", frame);
+        value = {coords.At(0).Get<int>(), coords.At(1).Get<int>()};
+    }
+};
+
+// ReadAs() from raw fragment must behave exactly as Get() from DOM (samples have at most one error)
+template<typename T>
+static void checkReadAs(string_view sample) {
+    CAPTURE(sample);
+    DefaultArena alloc;
+    string domErr, rawErr;
+    T dom{}, raw{};
+    try {
+        dom = ParseJson(sample, alloc).Get<T>();
+    } catch (std::exception& e) {
+        domErr = e.what();
+    }
+    try {
+        raw = ReadAs<T>(JsonView::Raw(sample), alloc);
+    } catch (std::exception& e) {
+        rawErr = e.what();
+    }
+    CHECK_EQ(rawErr, domErr);
+    CHECK(DeepEqual(JsonView::From(raw, alloc), JsonView::From(dom, alloc)));
+}
+
 TEST_CASE("deserialize")
 {
     SUBCASE("basic") {
@@ -318,6 +751,64 @@ TEST_CASE("deserialize")
         CHECK_EQ(vec.at(0), 54);
         CHECK_EQ(vec.at(1), -15);
     }
+    SUBCASE("from raw") {
+        checkReadAs<test::Data>(R"({
+            "skip": [{"a": [1, 2]}, "\"]"],
+            "a":5, "b": 150,
+            "nested": {"a": 123, "b": "av\u0061va\n", "en": "chebureck"}
+        })");
+        checkReadAs<test::Data>(R"({"a":5, "b": -15, "nested": {"a": 123, "b": "avava", "en": "kek"}})");
+        checkReadAs<test::Data>(R"({"a":5, "b": 15, "nested": {"a": 123, "b": 3, "en": "kek"}})");
+        checkReadAs<test::Data>(R"({"a":5, "nested": {"a": 123, "b": "", "en": "kek"}})");
+        checkReadAs<test::Data>(R"([5, 15])");
+        checkReadAs<TupleLike>(R"([1, null, 3, 4])");
+        checkReadAs<TupleLike>(R"([1, "y", {}, 4])");
+        checkReadAs<TupleLike>(R"([1, "y"])");
+        checkReadAs<TupleLike>(R"([1])");
+        checkReadAs<TupleLike>(R"([1, 2, 3])");
+        checkReadAs<Loose>(R"({})");
+        checkReadAs<Loose>(R"({"v": [1, 2,], "a": 3})");
+        checkReadAs<Loose>(R"({"a": null})");
+        checkReadAs<Loose>(R"({"v": {}})");
+        checkReadAs<Validated>(R"({"a": 1, "tuples": {"one": [1, null, 3], "two": [2, "2", 2]}})");
+        checkReadAs<Validated>(R"({"a": -1, "tuples": {}})");
+        checkReadAs<Validated>(R"({"a": 1, "tuples": {"one": [1, null, 3.5]}})");
+        checkReadAs<std::vector<std::optional<Nested>>>(R"([null, {"a": 1, "b": "", "en": "kek"}])");
+        checkReadAs<std::vector<std::optional<Nested>>>(R"([null, {"a": 1, "b": "", "en": "lol"}])");
+        checkReadAs<Point>(R"({"coords": [3, 4]})");
+        checkReadAs<Point>(R"({"x": 3, "y": 4})");
+        checkReadAs<std::vector<Point>>(R"([{"coords": [3, 4]}, {"coords": [5]}])");
+        DefaultArena pointAlloc;
+        auto point = ReadAs<Point>(JsonView::Raw(R"({"coords": [3, 4]})"), pointAlloc);
+        CHECK_EQ(point.x, 3);
+        CHECK_EQ(point.y, 4);
+        DefaultArena alloc;
+        CHECK_THROWS_AS(ReadAs<Loose>(JsonView::Raw(R"({"a": 1,, "v": []})"), alloc), ParsingError);
+        CHECK_THROWS_AS(ReadAs<Loose>(JsonView::Raw(R"({"a": 1} 2)"), alloc), ParsingError);
+        CHECK_THROWS_AS(ReadAs<Loose>(JsonView::Raw(R"({"a": 1, "unknown": [1, }, "v": []})"), alloc), ParsingError);
+    }
+    SUBCASE("merge with keys") {
+        DefaultArena alloc;
+        auto parse = [&](string_view json){
+            return ParseJsonInPlace(json, alloc);
+        };
+        auto res = parse(R"({"0": 0, "al": 4, "alp": 0, "alpha": 2, "b": 0, "mid": "3", "zeta": 1, "zz": 0})").Get<Unsorted>();
+        CHECK_EQ(res.al, 4);
+        CHECK_EQ(res.alpha, 2);
+        CHECK_EQ(res.mid, "3");
+        CHECK_EQ(res.zeta, 1);
+        CHECK_THROWS_AS(parse(R"({"al": 4, "alpha": 2, "zeta": 1})").Get<Unsorted>(), KeyError);
+        // much wider object: fields are looked up by binary search
+        std::string wide = "{";
+        for (int i = 0; i < 100; ++i) {
+            wide += "\"k" + std::to_string(i) + "\": " + std::to_string(i) + ", ";
+        }
+        wide += R"("v": [1], "zz": 0})";
+        auto loose = parse(wide).Get<Loose>();
+        CHECK_EQ(loose.a, 7);
+        CHECK_EQ(loose.v.size(), 1);
+        CHECK_THROWS_AS(parse(R"({"a": 1, "b": "2", "zz": 0})").Get<Nested>(), KeyError);
+    }
 }
 
 TEST_CASE("describe") {
@@ -408,5 +899,386 @@ TEST_CASE("serialize")
         test_one(ser_map["kek"]);
         test_one(ser_map["cheburek"]);
     }
+    SUBCASE("unsorted fields") {
+        DefaultArena ctx;
+        static_assert(jv::detail::sortFields<Unsorted>().slots[0] == 3);
+        static_assert(jv::detail::sortFields<Unsorted>().slots[3] == 0);
+        Unsorted value{1, 2, "3", 4};
+        auto res = JsonView::From(value, ctx);
+        auto keys = res.Object(false);
+        CHECK(std::is_sorted(keys.begin(), keys.end(), KeyLess{}));
+        CHECK_EQ(res["al"].Get<int>(), 4);
+        CHECK_EQ(res["alpha"].Get<int>(), 2);
+        CHECK_EQ(res["mid"].Get<string_view>(), "3");
+        CHECK_EQ(res["zeta"].Get<int>(), 1);
+        CHECK_EQ(res.Get<Unsorted>().zeta, 1);
+    }
+    SUBCASE("direct") {
+        DefaultArena ctx;
+        test::Data data{1, 2, {3, "12\n3", chebureck}};
+        std::map<string, TupleLike> tuples{
+            {"full", {1, "y", 3}},
+            {"empty", {-1, std::nullopt, 0}},
+        };
+        auto check = [&](auto const& value){
+            auto dom = JsonView::From(value, ctx);
+            membuff::StringOut json;
+            SerializeJson(json, value);
+            auto text = json.Consume();
+            CHECK(DeepEqual(ParseJsonInPlace(string_view{text}, ctx), dom));
+            membuff::StringOut msgpack;
+            SerializeMsgPack(msgpack, value);
+            auto packed = msgpack.Consume();
+            CHECK(DeepEqual(ParseMsgPackInPlace(packed, ctx), dom));
+            auto sizeOk = packed.size() == MsgPackSize(dom);
+            CHECK(sizeOk);
+        };
+        check(data);
+        check(std::vector<test::Data>{data, data});
+        check(tuples);
+        check(std::make_pair(std::optional<int>{}, std::tuple<double, bool>{1.5, true}));
+        check(Validated{5, tuples});
+        Nested invalid{1, "", Lol(5)};
+        membuff::StringOut out;
+        CHECK_THROWS(SerializeJson(out, invalid));
+        std::vector<std::vector<int>> deep{{1}};
+        CHECK_THROWS_AS(SerializeMsgPack(out, deep, {false, 2}), DepthError);
+        SerializeMsgPack(out, deep, {false, 3});
+    }
+    SUBCASE("own convert") {
+        DefaultArena ctx;
+        std::vector<Repeated> value{{"ab", 1000}, {"c", 3}};
+        auto dom = JsonView::From(value, ctx);
+        CHECK(dom[0].Is(t_string));
+        membuff::StringOut json;
+        SerializeJson(json, value);
+        CHECK_EQ(json.Consume(), dom.Dump());
+        // converted values die with temporary arena: they must be copied
+        membuff::SegmentedOut segmented(1024, 64);
+        SerializeMsgPack(segmented, value);
+        DefaultArena other;
+        ::memset(other(20000, 1), 'z', 20000);
+        std::string joined;
+        for (auto& seg: segmented.Segments()) {
+            joined.append(seg.data, seg.size);
+        }
+        CHECK_EQ(joined, DumpMsgPack(dom));
+    }
+}
+
+
+struct Blob {
+    Bytes data;
+    std::string name;
+};
+DESCRIBE("Blob", Blob) {
+    MEMBER("data", &_::data);
+    MEMBER("name", &_::name);
+}
+
+TEST_CASE("base64")
+{
+    SUBCASE("roundtrip") {
+        CHECK_EQ(Base64Size(0), 0);
+        CHECK_EQ(Base64Size(4), 8);
+        string_view plain = "Many hands make light work.";
+        string text(Base64Size(plain.size()), '\0');
+        CHECK_EQ(EncodeBase64(text.data(), plain), text.data() + text.size());
+        CHECK_EQ(text, "TWFueSBoYW5kcyBtYWtlIGxpZ2h0IHdvcmsu");
+        // lengths around block sizes of vectorized code, all byte values
+        for (size_t len = 0; len < 200; ++len) {
+            string data(len, '\0');
+            for (size_t i = 0; i < len; ++i) {
+                data[i] = char(i * 37 + len);
+            }
+            string encoded(Base64Size(len), '\0');
+            EncodeBase64(encoded.data(), data);
+            string decoded(Base64DecodedSize(encoded), '\0');
+            auto end = DecodeBase64(decoded.data(), encoded);
+            REQUIRE(end);
+            decoded.resize(size_t(end - decoded.data()));
+            CHECK_EQ(decoded, data);
+            // unpadded
+            while (!encoded.empty() && encoded.back() == '=') {
+                encoded.pop_back();
+            }
+            CHECK_EQ(Base64DecodedSize(encoded), len);
+            CHECK_EQ(DecodeBase64(decoded.data(), encoded), decoded.data() + len);
+            CHECK_EQ(decoded, data);
+        }
+    }
+    SUBCASE("invalid") {
+        char buff[128];
+        CHECK(DecodeBase64(buff, "QUJD"));
+        CHECK_FALSE(DecodeBase64(buff, "Q"));
+        CHECK_FALSE(DecodeBase64(buff, "QU=D"));
+        CHECK_FALSE(DecodeBase64(buff, "Q==="));
+        CHECK_FALSE(DecodeBase64(buff, "QUJD QUJD"));
+        CHECK_FALSE(DecodeBase64(buff, "QUJD-_JD"));
+        // invalid char in the middle of long input (which is decoded in blocks)
+        string text(96, 'A');
+        CHECK_EQ(DecodeBase64(buff, text), buff + 72);
+        for (size_t pos: {0, 17, 40, 63, 95}) {
+            auto bad = text;
+            bad[pos] = '.';
+            CHECK_FALSE(DecodeBase64(buff, bad));
+        }
+    }
+    SUBCASE("dump and read") {
+        DefaultArena alloc;
+        string payload(1000, '\0');
+        for (size_t i = 0; i < payload.size(); ++i) {
+            payload[i] = char(i ^ (i >> 3));
+        }
+        Blob blob{Bytes(payload.begin(), payload.end()), "file"};
+        auto dom = JsonView::From(blob, alloc);
+        CHECK(dom["data"].Is(t_binary));
+        auto json = dom.Dump();
+        CHECK_EQ(JsonSizeBound(dom), json.size());
+        auto parsed = ParseJsonInPlace(string_view{json}, alloc);
+        CHECK(parsed["data"].Is(t_string));
+        CHECK_EQ(DecodeBinary(parsed["data"], alloc).GetBinary(), payload);
+        CHECK(parsed.Get<Blob>().data == blob.data);
+        auto packed = dom.DumpMsgPack();
+        CHECK(ParseMsgPackInPlace(packed, alloc).result.Get<Blob>().data == blob.data);
+        // output buffer is smaller than encoded value
+        std::string chunked;
+        membuff::FuncOut out([&](const char* data, size_t size){
+            chunked.append(data, size);
+        });
+        DumpJsonInto(out, dom);
+        out.Flush();
+        CHECK_EQ(chunked, json);
+        membuff::StringOut direct;
+        SerializeJson(direct, blob);
+        CHECK_EQ(direct.Consume(), json);
+        membuff::StringOut directPacked;
+        SerializeMsgPack(directPacked, blob);
+        CHECK_EQ(directPacked.Consume(), packed);
+        auto bad = ParseJsonInPlace(R"({"name": "x", "data": "QU=D"})", alloc);
+        CHECK_THROWS_AS(bad.Get<Blob>(), ForeignError);
+        CHECK_THROWS_AS(DecodeBinary(JsonView(1), alloc), TypeMissmatch);
+    }
 }
 
+TEST_CASE("arena")
+{
+    SUBCASE("block pool") {
+        auto limits = GetArenaPoolLimits();
+        auto fill = [](size_t blocks) {
+            DefaultArena<0> alloc;
+            alloc.SetGrowth({4096, 4096, 0});
+            for (size_t i = 0; i < blocks; ++i) {
+                ::memset(alloc(3000, 1), 1, 3000);
+            }
+            // out-of-band: never pooled
+            ::memset(alloc(10000), 1, 10000);
+        };
+        SetArenaPoolLimits({1 << 20, 0});
+        TrimArenaPool();
+        fill(4);
+        auto warm = GetArenaPoolStats();
+        CHECK_EQ(warm.threadCached, 4 * 4096);
+        fill(4);
+        auto steady = GetArenaPoolStats();
+        CHECK_EQ(steady.reused - warm.reused, 4);
+        CHECK_EQ(steady.allocated - warm.allocated, 1);
+        CHECK_EQ(steady.recycled - warm.recycled, 4);
+        CHECK_EQ(steady.freed - warm.freed, 1);
+        // over the limit: extra blocks are freed
+        SetArenaPoolLimits({2 * 4096, 0});
+        TrimArenaPool();
+        fill(4);
+        auto limited = GetArenaPoolStats();
+        CHECK_EQ(limited.threadCached, 2 * 4096);
+        CHECK_EQ(limited.freed - steady.freed, 3);
+        // shared cache takes what does not fit
+        SetArenaPoolLimits({0, 1 << 20});
+        TrimArenaPool(true);
+        fill(4);
+        CHECK_EQ(GetArenaPoolStats().sharedCached, 4 * 4096);
+        std::thread([&]{
+            auto before = GetArenaPoolStats();
+            fill(4);
+            CHECK_EQ(GetArenaPoolStats().reused - before.reused, 4);
+        }).join();
+        TrimArenaPool(true);
+        CHECK_EQ(GetArenaPoolStats().sharedCached, 0);
+        SetArenaPoolLimits(limits);
+    }
+    SUBCASE("extend") {
+        DefaultArena alloc;
+        auto first = static_cast<char*>(alloc(100, 1));
+        CHECK(alloc.TryExtend(first, 100, 1000));
+        CHECK(alloc.TryExtend(first, 1000, 10));
+        auto second = static_cast<char*>(alloc(10, 1));
+        CHECK_EQ(second, first + 10);
+        CHECK_FALSE(alloc.TryExtend(first, 10, 20));
+        CHECK_FALSE(alloc.TryExtend(second, 10, 100000));
+        ArenaString str(alloc);
+        str.Append("start");
+        auto data = str.data();
+        for (unsigned i = 0; i < 100; ++i) {
+            str.Append("0123456789");
+        }
+        CHECK_EQ(str.data(), data);
+        CHECK_EQ(str.size(), 1005);
+        CHECK_EQ(string_view(str).substr(0, 10), "start01234");
+        // not the last one: copied
+        alloc(1, 1);
+        str.Append(str);
+        CHECK_NE(str.data(), data);
+        CHECK_EQ(str.size(), 2010);
+        CHECK_EQ(string_view(str).substr(1005, 10), "start01234");
+        NullArena none;
+        CHECK_FALSE(none.TryExtend(nullptr, 0, 0));
+    }
+    SUBCASE("rewind") {
+        DefaultArena<0> alloc;
+        alloc.SetGrowth({4096, 4096, 0});
+        auto outer = alloc.Mark();
+        auto first = alloc(100);
+        ArenaPoolStats warm;
+        for (unsigned round = 0; round < 3; ++round) {
+            if (round == 1) {
+                warm = GetArenaPoolStats();
+            }
+            ArenaScope scope(alloc);
+            for (unsigned i = 0; i < 10; ++i) {
+                ::memset(alloc(1000, 1), 1, 1000);
+            }
+            {
+                ArenaScope nested(alloc);
+                ::memset(alloc(3000, 1), 2, 3000);
+            }
+            // out-of-band
+            ::memset(alloc(20000), 3, 20000);
+        }
+        auto after = GetArenaPoolStats();
+        // blocks of first round were kept for next ones, only out-of-band ones are taken again
+        CHECK_EQ(after.reused + after.allocated - warm.reused - warm.allocated, 2);
+        CHECK_EQ(alloc(100), static_cast<char*>(first) + 112);
+        alloc.Rewind(outer);
+        CHECK_EQ(alloc(100), first);
+        // allocation made before mark is not extended over it: bytes past mark
+        // would be handed out again after rewind
+        DefaultArena arena;
+        ArenaString s("hello", arena);
+        auto before = s.data();
+        {
+            ArenaScope sc(arena);
+            s.Append(", world");
+            // moved into scope (and dies with it)
+            CHECK_NE(s.data(), before);
+        }
+        ::memset(arena.Allocate(16, 1), 'X', 16);
+        CHECK_EQ(string_view(before, 5), "hello");
+        auto last = arena.Allocate(4, 1);
+        {
+            ArenaScope sc(arena);
+            CHECK_FALSE(arena.TryExtend(last, 4, 8));
+        }
+        CHECK(arena.TryExtend(last, 4, 8));
+    }
+    SUBCASE("spare limit") {
+        // long-living arena (e.g. of connection) after one oversized message
+        DefaultArena<0> conn;
+        {
+            ArenaScope message(conn);
+            for (unsigned i = 0; i < 10000; ++i) {
+                ::memset(conn(1000, 1), 1, 1000);
+            }
+            CHECK(conn.Stats().reserved > 10'000'000);
+        }
+        auto after = conn.Stats();
+        CHECK(after.reserved > 0);
+        CHECK(after.reserved <= conn.GetSpareLimit());
+        conn.SetSpareLimit(0);
+        {
+            ArenaScope message(conn);
+            (void)conn(1000, 1);
+        }
+        CHECK_EQ(conn.Stats().reserved, 0);
+    }
+    SUBCASE("stats") {
+        DefaultArena<0> alloc;
+        alloc.SetGrowth({4096, 4096, 0});
+        CHECK_EQ(alloc.Stats().blocks, 0);
+        for (unsigned i = 0; i < 5; ++i) {
+            (void)alloc(1000, 1);
+        }
+        auto st = alloc.Stats();
+        CHECK_EQ(st.requested, 5000);
+        CHECK_EQ(st.blocks, 2);
+        CHECK_EQ(st.reserved, 8192);
+        // 4080 bytes of first block fit 4 allocations
+        CHECK_EQ(st.wasted, 80);
+        CHECK_EQ(st.outOfBand, 0);
+        (void)alloc(10000);
+        auto big = alloc.Stats().Since(st);
+        CHECK_EQ(big.requested, 10000);
+        CHECK_EQ(big.outOfBand, 1);
+        CHECK_EQ(big.blocks, 3);
+        alloc.SetLimit(big.reserved + 6000);
+        {
+            ArenaScope scope(alloc);
+            (void)alloc(5000);
+            CHECK_THROWS_AS((void)alloc(5000), std::bad_alloc);
+        }
+        // out-of-band block was released
+        CHECK_EQ(alloc.Stats().reserved, big.reserved);
+        (void)alloc(5000);
+        alloc.ResetStats();
+        CHECK_EQ(alloc.Stats().requested, 0);
+        CHECK_EQ(alloc.Stats().blocks, 4);
+        alloc.Clear();
+        CHECK_EQ(alloc.Stats().reserved, 0);
+        Arena& base = alloc;
+        CHECK_EQ(base.Stats().blocks, 0);
+    }
+    SUBCASE("growth") {
+        DefaultArena<0> alloc;
+        alloc.SetGrowth({4096, 32768, 1 << 20});
+        for (unsigned i = 0; i < 100; ++i) {
+            ::memset(alloc(1000, 1), 1, 1000);
+        }
+        // 4 + 8 + 16 + 32 + 32 + 32 allocations
+        auto st = alloc.Stats();
+        CHECK_EQ(st.blocks, 6);
+        CHECK_EQ(st.reserved, 4096 + 8192 + 16384 + 3 * 32768);
+        CHECK_EQ(st.outOfBand, 0);
+        {
+            ArenaScope scope(alloc);
+            // larger than next block: own one
+            ::memset(alloc(40000), 2, 40000);
+            CHECK_EQ(alloc.Stats().Since(st).outOfBand, 1);
+            CHECK_EQ(alloc.Stats().reserved, st.reserved + 40016);
+            // mapped one, aligned for huge pages
+            auto huge = static_cast<char*>(alloc(3 << 20));
+            ::memset(huge, 3, 3 << 20);
+            CHECK_EQ(reinterpret_cast<uintptr_t>(huge - 16) % (2 << 20), 0);
+            CHECK_EQ(alloc.Stats().reserved, st.reserved + 40016 + (3 << 20) + 4096);
+        }
+        // own blocks are released, regular ones are kept
+        CHECK_EQ(alloc.Stats().reserved, st.reserved);
+        alloc.Clear();
+        (void)alloc(1000, 1);
+        CHECK_EQ(alloc.Stats().reserved, 4096);
+        alloc.SetBlockSize(100000);
+        CHECK_EQ(alloc.GetGrowth().firstBlock, 100000);
+        CHECK_EQ(alloc.GetGrowth().maxBlock, 100000);
+        // growth blocks over hugeThreshold are mapped as well, and not kept as spare
+        DefaultArena<0> big;
+        big.SetGrowth({4 << 20, 16 << 20, 2 << 20});
+        auto first = static_cast<char*>(big(1000, 1));
+        CHECK_EQ(reinterpret_cast<uintptr_t>(first - 16) % (2 << 20), 0);
+        CHECK_EQ(big.Stats().reserved, 4 << 20);
+        {
+            ArenaScope scope(big);
+            auto next = static_cast<char*>(big((4 << 20) - 100, 1));
+            CHECK_EQ(reinterpret_cast<uintptr_t>(next - 16) % (2 << 20), 0);
+            CHECK_EQ(big.Stats().reserved, 12 << 20);
+        }
+        CHECK_EQ(big.Stats().reserved, 4 << 20);
+    }
+}
@@ -99,10 +99,36 @@ TEST_CASE("roundtrip") {
         auto serialized = DumpMsgPack(json);
         auto back = ParseMsgPackInPlace(serialized, ctx);
         CHECK(DeepEqual(json, back));
+        CHECK_EQ(MsgPackSize(json), serialized.size());
+        std::string exact(serialized.size(), '\0');
+        CHECK_EQ(DumpMsgPackTo(exact.data(), json), exact.data() + exact.size());
+        CHECK_EQ(exact, serialized);
     };
     GIVEN("rpc sample") {
         do_one(MsgPackRPC, sizeof(MsgPackRPC));
     }
+    GIVEN("read into containers") {
+        DefaultArena ctx;
+        auto packed = DumpMsgPack(R"({"a": [1, 2, 3], "b": [-1], "c": null})"_json.View());
+        auto raw = JsonView::Raw(packed, RawFormat::msgpack);
+        auto res = ReadAs<std::map<string, std::optional<std::vector<int>>>>(raw, ctx);
+        CHECK_EQ(res.size(), 3);
+        CHECK_EQ(res["a"]->at(2), 3);
+        CHECK_EQ(res["b"]->at(0), -1);
+        CHECK_FALSE(res["c"]);
+        using Ints = std::map<string, std::vector<int>>;
+        using Strings = std::map<string, std::vector<string>>;
+        CHECK_THROWS_AS(ReadAs<Ints>(raw, ctx), TypeMissmatch);
+        CHECK_THROWS_AS(ReadAs<Strings>(raw, ctx), TypeMissmatch);
+        // strings are not copied
+        auto strings = DumpMsgPack(R"(["abc", "def"])"_json.View());
+        auto views = ReadAs<std::vector<string_view>>(JsonView::Raw(strings, RawFormat::msgpack), ctx);
+        CHECK_EQ(views.at(1), "def");
+        CHECK(views.at(1).data() > strings.data());
+        CHECK(views.at(1).data() < strings.data() + strings.size());
+        auto truncated = packed.substr(0, packed.size() - 2);
+        CHECK_THROWS_AS(ReadAs<Json>(JsonView::Raw(truncated, RawFormat::msgpack), ctx), ParsingError);
+    }
     GIVEN("books sample") {
         do_one(MsgPackBooks, sizeof(MsgPackBooks));
     }
@@ -113,6 +139,34 @@ TEST_CASE("parse") {
         auto json = ParseMsgPackInPlace(MsgPackRPC, sizeof(MsgPackRPC), ctx).result;
         CHECK_EQ(json["params"][0].Get<int>(), 3);
     }
+    GIVEN("unsorted keys") {
+        DefaultArena ctx;
+        // {"b": 1, "a": 2, "b": 3}
+        uint8_t raw[] = {0x83, 0xa1, 'b', 0x01, 0xa1, 'a', 0x02, 0xa1, 'b', 0x03};
+        auto json = ParseMsgPackInPlace(raw, sizeof(raw), ctx).result;
+        CHECK_EQ(json.Size(), 2);
+        CHECK_EQ(json.Object().begin()->key, "a");
+        CHECK_EQ(json["b"].Get<int>(), 3);
+    }
+    GIVEN("raw keys") {
+        DefaultArena ctx;
+        string_view keys[] = {"params"};
+        ParseSettings lazy;
+        lazy.rawKeys = keys;
+        lazy.rawKeysCount = 1;
+        auto json = ParseMsgPackInPlace(MsgPackRPC, sizeof(MsgPackRPC), ctx, lazy).result;
+        REQUIRE(json["params"].Is(t_raw));
+        CHECK(json["params"].GetRawFormat() == RawFormat::msgpack);
+        CHECK_EQ(Materialize(json["params"], ctx)[0].Get<int>(), 3);
+        CHECK(DeepEqual(json, ParseMsgPackInPlace(MsgPackRPC, sizeof(MsgPackRPC), ctx).result));
+        // raw fragment is written back as is
+        CHECK_EQ(DumpMsgPack(json["params"]), json["params"].GetRaw());
+        auto back = ParseMsgPack(DumpMsgPack(json), ctx).result;
+        CHECK(DeepEqual(json, back));
+        // {"params": [1, <missing>]}
+        uint8_t truncated[] = {0x81, 0xa6, 'p', 'a', 'r', 'a', 'm', 's', 0x92, 0x01};
+        CHECK_THROWS_AS((void)ParseMsgPackInPlace(truncated, sizeof(truncated), ctx, lazy), ParsingError);
+    }
     GIVEN("books sample") {
         DefaultArena ctx;
         auto json = ParseMsgPackInPlace(MsgPackBooks, sizeof(MsgPackBooks), ctx).result;
@@ -125,6 +179,59 @@ TEST_CASE("parse") {
                     ["GlossSeeAlso"]
                     [1].GetString() == "XML");
     }
+    GIVEN("stream") {
+        DefaultArena ctx;
+        std::string books{reinterpret_cast<const char*>(MsgPackBooks), sizeof(MsgPackBooks)};
+        std::string rpc{reinterpret_cast<const char*>(MsgPackRPC), sizeof(MsgPackRPC)};
+        // several messages back to back (with str32 and scalars, which have no payload)
+        std::string stream = rpc + books + std::string("\xdb\x00\x00\x00\x02hi", 7) + "\x05\xc0" + rpc;
+        for (size_t chunk: {1, 3, 64, 4096}) {
+            MsgPackStreamParser parser(ctx);
+            std::vector<JsonView> messages;
+            for (size_t i = 0; i < stream.size(); i += chunk) {
+                // chunks do not have to outlive parser
+                std::string part = stream.substr(i, chunk);
+                string_view left = part;
+                while (!left.empty()) {
+                    auto status = parser.Feed(left);
+                    left.remove_prefix(status.consumed);
+                    if (status.done) {
+                        messages.push_back(parser.Result());
+                        // empty chunk does not start next message
+                        auto idle = parser.Feed({});
+                        CHECK_EQ(idle.consumed, 0);
+                        CHECK(idle.done);
+                    }
+                }
+            }
+            CHECK_FALSE(parser.Pending());
+            REQUIRE_EQ(messages.size(), 6);
+            CHECK(DeepEqual(messages[0], ParseMsgPack(rpc, ctx)));
+            CHECK(DeepEqual(messages[1], ParseMsgPack(books, ctx)));
+            CHECK_EQ(messages[2].GetString(), "hi");
+            CHECK_EQ(messages[3].Get<int>(), 5);
+            CHECK(messages[4].Is(t_null));
+            CHECK(DeepEqual(messages[5], messages[0]));
+            CHECK(DeepEqual(parser.Finish(), messages[0]));
+        }
+        MsgPackStreamParser partial(ctx);
+        auto status = partial.Feed(rpc.substr(0, 10));
+        CHECK_EQ(status.consumed, 10);
+        CHECK_FALSE(status.done);
+        CHECK(partial.Pending());
+        CHECK_THROWS_AS((void)partial.Finish(), ParsingError);
+        MsgPackStreamParser invalid(ctx);
+        CHECK_THROWS_AS((void)invalid.Feed("\x92\x01\xc1"), ParsingError);
+        // structure is checked only when message is complete
+        MsgPackStreamParser badKey(ctx);
+        CHECK_THROWS_AS((void)badKey.Feed("\x81\x01\x02"), ParsingError);
+        MsgPackStreamParser whole(ctx);
+        CHECK(whole.Feed("\x92\x01\x02").done);
+        auto idle = whole.Feed("");
+        CHECK_EQ(idle.consumed, 0);
+        CHECK(idle.done);
+        CHECK_EQ(whole.Result().Size(), 2);
+    }
 }
 TEST_CASE("big containers") {
     auto bigarr = MutableJson(t_array);
@@ -143,6 +250,85 @@ TEST_CASE("big containers") {
     back = ParseMsgPackInPlace(pack, ctx).result;
     CHECK(back == source);
 }
+TEST_CASE("numeric arrays") {
+    DefaultArena ctx;
+    std::vector<double> doubles(1000);
+    for (size_t i = 0; i < doubles.size(); ++i) {
+        doubles[i] = double(i) * 0.37 - 100;
+    }
+    auto view = JsonView::From(doubles, ctx);
+    auto packed = DumpMsgPack(view);
+    CHECK_EQ(packed.size(), 3 + doubles.size() * 9);
+    CHECK(ParseMsgPackInPlace(packed, ctx).result.Get<std::vector<double>>() == doubles);
+    // output with small fixed buffer
+    std::string flushed;
+    membuff::FuncOut out([&](const char* data, size_t size){
+        flushed.append(data, size);
+    });
+    DumpMsgPackInto(out, view);
+    out.Flush();
+    CHECK_EQ(flushed, packed);
+    membuff::StringOut direct;
+    SerializeMsgPack(direct, doubles);
+    CHECK_EQ(direct.Consume(), packed);
+    // runs of doubles mixed with other items
+    auto mixed = R"([1.5, 2.5, 3, "x", 4.5, -1, 1e300])"_json;
+    CHECK(JsonFromVec(DumpAsVec(mixed)) == mixed);
+    auto numbers = Json::Parse("[1.5, 2, -3, 4e3]").View().Get<std::vector<double>>();
+    CHECK(numbers == std::vector<double>{1.5, 2, -3, 4e3});
+    CHECK(Json::Parse("[1, 255, 3]").View().Get<std::vector<uint8_t>>().at(1) == 255);
+    CHECK_THROWS_AS(Json::Parse("[1, 256, 3]").View().Get<std::vector<uint8_t>>(), IntRangeError);
+    CHECK_THROWS_AS(Json::Parse("[1, -1]").View().Get<std::vector<uint8_t>>(), IntRangeError);
+    CHECK_THROWS_AS(Json::Parse("[1, 2.5]").View().Get<std::vector<int>>(), TypeMissmatch);
+    CHECK_THROWS_AS(Json::Parse("[1, null]").View().Get<std::vector<double>>(), TypeMissmatch);
+    CHECK_THROWS_AS(DumpMsgPack(JsonView::From(std::vector<std::vector<double>>{{1.}}, ctx), {false, 2}), DepthError);
+}
+TEST_CASE("segmented out") {
+    DefaultArena ctx;
+    std::string big(5000, 'x');
+    std::string blob(3000, '\x01');
+    JsonView items[] = {JsonView(big), JsonView("small"), JsonView::Binary(blob), JsonView(1)};
+    JsonView source(items, 4);
+    membuff::SegmentedOut out(1024, 64);
+    DumpMsgPackInto(out, source);
+    auto& segments = out.Segments();
+    std::string joined;
+    for (auto& s: segments) {
+        joined.append(s.data, s.size);
+    }
+    CHECK_EQ(joined, DumpMsgPack(source));
+    CHECK_EQ(out.TotalSize(), joined.size());
+    // payloads are not copied
+    auto referenced = [&](const std::string& payload) {
+        for (auto& s: segments) {
+            if (s.data == payload.data() && s.size == payload.size()) return true;
+        }
+        return false;
+    };
+    CHECK(referenced(big));
+    CHECK(referenced(blob));
+    // json raw is parsed into temporary arena: its strings (escaped ones are always
+    // unescaped there) must be copied, not referenced
+    std::string raw = R"({"escaped": ")" + std::string(2000, 'y') + R"(\n", "plain": ")" + big + R"("})";
+    JsonView withRaw[] = {JsonView::Raw(raw, RawFormat::json), JsonView(big)};
+    membuff::SegmentedOut rawOut(1024, 64);
+    DumpMsgPackInto(rawOut, JsonView(withRaw, 2));
+    DefaultArena other;
+    // recycled blocks of that arena are overwritten
+    ::memset(other(20000, 1), 'z', 20000);
+    std::string rawJoined;
+    for (auto& s: rawOut.Segments()) {
+        rawJoined.append(s.data, s.size);
+    }
+    CHECK_EQ(rawJoined, DumpMsgPack(JsonView(withRaw, 2)));
+    auto topLevel = [&]{
+        for (auto& s: rawOut.Segments()) {
+            if (s.data == big.data()) return true;
+        }
+        return false;
+    };
+    CHECK(topLevel());
+}
 TEST_CASE("null")
 {
     json const j;
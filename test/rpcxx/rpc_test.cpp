@@ -34,10 +34,15 @@ enum format {
     direct,
     msgpack,
     json,
+    lazy_msgpack,
+    lazy_json,
 };
 
 struct MockTransport : IAsyncTransport {
-    using IAsyncTransport::IAsyncTransport;
+    MockTransport(Protocol proto, rc::Weak<IHandler> h = nullptr) :
+        IAsyncTransport(proto, h), proto(proto)
+    {}
+    Protocol proto;
     format fmt = direct;
     void Send(JsonView msg) override {
         switch (fmt) {
@@ -63,6 +68,18 @@ struct MockTransport : IAsyncTransport {
             Receive(back);
             break;
         }
+        case lazy_msgpack: {
+            auto serial = DumpMsgPack(msg);
+            DefaultArena alloc;
+            Receive(ParseMsgPackInPlace(serial, alloc, LazyParseSettings(proto)));
+            break;
+        }
+        case lazy_json: {
+            auto serial = DumpJson(msg);
+            DefaultArena alloc;
+            Receive(ParseJsonInPlace(serial.data(), serial.size(), alloc, LazyParseSettings(proto)));
+            break;
+        }
         }
 
     }
@@ -78,6 +95,24 @@ DESCRIBE("Test", Test) {
     MEMBER("b", &_::b);
 }
 
+struct TestPartial {
+    int a;
+};
+
+DESCRIBE("TestPartial", TestPartial) {
+    MEMBER("a", &_::a);
+}
+
+struct TestWrong {
+    int a;
+    int b;
+};
+
+DESCRIBE("TestWrong", TestWrong) {
+    MEMBER("a", &_::a);
+    MEMBER("b", &_::b);
+}
+
 template<typename T, typename...Args>
 T req(Client& cli, string_view name, Args const&...a) {
     return ToStdFuture(cli.Request<T>(Method{name, NoTimeout}, a...)).get();
@@ -97,6 +132,24 @@ void extraMethods(Server& server) {
     server.Method("copy_named", [](Test arg){
         return arg;
     }, rpcxx::NamesMap("arg"));
+    server.Method("copy_pack", [](Test arg){
+        return arg;
+    }, PackParams<Test>{});
+    // cached responses: already encoded results are spliced into replies
+    static const std::string cachedJson = R"({"a": 7, "b": "json"})";
+    static const std::string cachedMsgPack = DumpMsgPack(Json::Parse(R"({"a": 8, "b": "msgpack"})").View());
+    server.Method("cached_json", []{
+        return JsonView::Raw(cachedJson);
+    });
+    server.Method("cached_msgpack", []{
+        return JsonView::Raw(cachedMsgPack, RawFormat::msgpack);
+    });
+    server.Method("tests", [](std::vector<Test> arg, optional<string> suffix){
+        for (auto& t: arg) {
+            t.b += suffix.value_or("");
+        }
+        return arg;
+    });
 }
 
 void basicTest(Client& cli) {
@@ -130,6 +183,12 @@ void basicTest(Client& cli) {
     CHECK_THROWS(req<string>(cli, "ping", "pong"));
     CHECK(req<Test>(cli, "copy", Test{1, ""}).a == 1);
     CHECK(req<Test>(cli, "copy_named", rpcxx::Arg("arg", Test{1, "123"})).b == "123");
+    CHECK(ToStdFuture(cli.RequestPack<Test>(Method{"copy_pack", NoTimeout}, Test{2, "a\"b"})).get().b == "a\"b");
+    CHECK(req<Test>(cli, "cached_json").b == "json");
+    CHECK(req<Test>(cli, "cached_msgpack").a == 8);
+    auto tests = req<std::vector<Test>>(cli, "tests", std::vector<Test>{{1, "a"}, {2, "b"}}, "!");
+    CHECK(tests.size() == 2);
+    CHECK(tests.at(1).b == "b!");
 }
 
 void batchTest(Client& cli) {
@@ -159,7 +218,7 @@ void batchTest(Client& cli) {
 TEST_CASE("rpc") {
     TestServer server;
     extraMethods(server);
-    for (auto format: {direct, json, msgpack}) {
+    for (auto format: {direct, json, msgpack, lazy_json, lazy_msgpack}) {
         for (auto proto: {Protocol::json_v2_compliant, Protocol::json_v2_minified}) {
             CAPTURE(PrintProto(proto));
             rc::Strong<IClientTransport> fwd = new ForwardToHandler(&server);
@@ -178,3 +237,108 @@ TEST_CASE("rpc") {
         }
     }
 }
+
+TEST_CASE("serialized results") {
+    // typed results are written as t_raw of given format, transports splice or transcode them
+    for (auto resultFormat: {RawFormat::json, RawFormat::msgpack}) {
+        TestServer server;
+        extraMethods(server);
+        server.SetResultFormat(resultFormat);
+        for (auto format: {direct, json, msgpack, lazy_json, lazy_msgpack}) {
+            rc::Strong<IClientTransport> fwd = new ForwardToHandler(&server);
+            rc::Strong<IClientTransport> send = new MockTransport(Protocol::json_v2_compliant, &server);
+            static_cast<MockTransport*>(send.get())->fmt = format;
+            Client cli;
+            for (auto& transport: {fwd, send}) {
+                cli.SetTransport(transport);
+                basicTest(cli);
+            }
+        }
+    }
+}
+
+TEST_CASE("lazy forward") {
+    TestServer server;
+    extraMethods(server);
+    for (auto format: {lazy_json, lazy_msgpack}) {
+        for (auto proto: {Protocol::json_v2_compliant, Protocol::json_v2_minified}) {
+            CAPTURE(PrintProto(proto));
+            rc::Strong<MockTransport> downstream = new MockTransport(proto, &server);
+            downstream->fmt = format;
+            Server gateway;
+            gateway.SetRoute("down", downstream.get());
+            int forwarded = 0;
+            gateway.AddRouteMiddleware([&](string_view, Request& req){
+                // passed through without parsing
+                CHECK(req.params.Is(t_raw));
+                forwarded++;
+            });
+            rc::Strong<MockTransport> upstream = new MockTransport(proto, &gateway);
+            upstream->fmt = format;
+            Client cli(upstream.get());
+            CHECK(req<int>(cli, "down/add", 1, 2) == 3);
+            CHECK(req<Test>(cli, "down/copy_named", rpcxx::Arg("arg", Test{1, "123"})).b == "123");
+            CHECK_THROWS(req<int>(cli, "down/add", "123"));
+            CHECK(forwarded == 3);
+        }
+    }
+}
+
+TEST_CASE("raw params") {
+    // raw params are read without DOM, errors must be the same
+    TestServer server;
+    extraMethods(server);
+    auto errorOf = [&](format fmt, auto call) {
+        rc::Strong<MockTransport> send = new MockTransport(Protocol::json_v2_compliant, &server);
+        send->fmt = fmt;
+        Client cli(send.get());
+        try {
+            call(cli);
+        } catch (std::exception& e) {
+            return string{e.what()};
+        }
+        return string{};
+    };
+    auto check = [&](auto call) {
+        auto expected = errorOf(msgpack, call);
+        CHECK(!expected.empty());
+        CHECK(errorOf(lazy_msgpack, call) == expected);
+        CHECK(errorOf(lazy_json, call) == expected);
+    };
+    check([](Client& cli){ req<int>(cli, "add"); });
+    check([](Client& cli){ req<int>(cli, "add", "1"); });
+    check([](Client& cli){ req<int>(cli, "add", 1, "2"); });
+    check([](Client& cli){ req<Test>(cli, "copy", 1); });
+    check([](Client& cli){ req<Test>(cli, "copy_named", rpcxx::Arg("arg", TestPartial{1})); });
+    check([](Client& cli){ req<Test>(cli, "copy_named", rpcxx::Arg("wrong", Test{})); });
+    check([](Client& cli){ req<Test>(cli, "copy_pack", 1, 2); });
+    check([](Client& cli){ req<std::vector<Test>>(cli, "tests", std::vector<TestWrong>{{1, 2}}); });
+    // extra positional params are ignored
+    for (auto fmt: {lazy_msgpack, lazy_json}) {
+        rc::Strong<MockTransport> send = new MockTransport(Protocol::json_v2_compliant, &server);
+        send->fmt = fmt;
+        Client cli(send.get());
+        CHECK(req<int>(cli, "add", 1, 2, std::vector<Test>{{3, "4"}}, "5") == 3);
+    }
+}
+
+TEST_CASE("receive stats") {
+    TestServer server;
+    extraMethods(server);
+    struct Counting : MockTransport {
+        using MockTransport::MockTransport;
+        unsigned calls = 0;
+        ArenaStats last;
+        void OnReceiveStats(JsonView, ArenaStats const& stats) noexcept override {
+            calls++;
+            last = stats;
+        }
+    };
+    rc::Strong<Counting> send = new Counting(Protocol::json_v2_compliant, &server);
+    Client cli(send.get());
+    CHECK(req<int>(cli, "add", 1, 2) == 3);
+    // request and then its response (which is received while request is handled)
+    CHECK(send->calls == 2);
+    CHECK_THROWS(req<int>(cli, "add", "1"));
+    CHECK(send->calls == 4);
+}